@@ -0,0 +1,39 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.const import CONF_ID
+
+DEPENDENCIES = ["fingerprint_sensor"]
+CODEOWNERS = ["@yourusername"]
+
+fingerprint_benchmark_ns = cg.esphome_ns.namespace("fingerprint_benchmark")
+FingerprintBenchmark = fingerprint_benchmark_ns.class_(
+    "FingerprintBenchmark", cg.Component
+)
+
+CONF_ITERATIONS = "iterations"
+CONF_LOOP_INTERVAL = "loop_interval"
+CONF_HOLD_TIME = "hold_time"
+CONF_EXIT_WHEN_DONE = "exit_when_done"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(FingerprintBenchmark),
+        cv.Optional(CONF_ITERATIONS, default=200): cv.int_range(min=1, max=100000),
+        # Pace of the simulated ESPHome main loop between two loop() passes
+        cv.Optional(
+            CONF_LOOP_INTERVAL, default="16ms"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_HOLD_TIME, default="5s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_EXIT_WHEN_DONE, default=True): cv.boolean,
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    cg.add(var.set_iterations(config[CONF_ITERATIONS]))
+    cg.add(var.set_loop_interval(config[CONF_LOOP_INTERVAL]))
+    cg.add(var.set_hold_time(config[CONF_HOLD_TIME]))
+    cg.add(var.set_exit_when_done(config[CONF_EXIT_WHEN_DONE]))
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+#include "esphome/components/fingerprint_sensor/fingerprint_sensor.h"
+
+namespace esphome {
+namespace fingerprint_benchmark {
+
+using fingerprint_sensor::ack_results;
+using fingerprint_sensor::CommandFrame;
+using fingerprint_sensor::FingerprintSensor;
+using fingerprint_sensor::MemoryStore;
+using fingerprint_sensor::PacketParser;
+using fingerprint_sensor::ProtocolStats;
+using fingerprint_sensor::ScanResult;
+using fingerprint_sensor::Search;
+using fingerprint_sensor::SensorPacket;
+using fingerprint_sensor::SensorEmulator;
+using fingerprint_sensor::VirtualClock;
+
+/**
+ * Touch-to-decision latency benchmark for the unlock path.
+ *
+ * Runs a private FingerprintSensor against the emulator on a virtual clock,
+ * so results are deterministic and a full run takes well under a second of
+ * wall time. Every touch lands at a random phase of the scan poll.
+ * A last line times the packet codec itself, in wall time.
+ */
+class FingerprintBenchmark : public Component {
+ public:
+  void set_iterations(uint32_t iterations) { iterations_ = iterations; }
+  void set_loop_interval(uint32_t interval_ms) { loop_interval_ms_ = interval_ms; }
+  void set_hold_time(uint32_t hold_ms) { hold_time_ms_ = hold_ms; }
+  void set_exit_when_done(bool exit_when_done) { exit_when_done_ = exit_when_done; }
+
+  float get_setup_priority() const override { return setup_priority::LATE; }
+
+  void setup() override {
+    ESP_LOGI(TAG, "Running %u iterations per path, loop interval %u ms", iterations_, loop_interval_ms_);
+    ESP_LOGI(TAG, "%-10s %6s %9s %9s %9s %8s %8s %7s %6s %9s", "path", "n", "p50 ms", "p99 ms", "max ms", "tx B",
+             "rx B", "trips", "leds", "decisions");
+
+    run_path({"match", KNOWN_FINGER, false, false});
+    run_path({"ring", UNKNOWN_FINGER, false, false});
+    run_path({"bad_image", KNOWN_FINGER, true, false});
+    run_path({"held", KNOWN_FINGER, false, true});
+    // Same finger enrolled deep in the library, without and with a hot set
+    run_path({"deep", KNOWN_FINGER, false, false, DEEP_SLOT});
+    run_path({"deep_hot", KNOWN_FINGER, false, false, DEEP_SLOT, HOT_SET_SIZE});
+    run_path({"ring_hot", UNKNOWN_FINGER, false, false, DEEP_SLOT, HOT_SET_SIZE});
+    // Link negotiated up from the sensor's default 57600
+    run_path({"match_fast", KNOWN_FINGER, false, false, 1, 0, FAST_BAUD_RATE});
+    run_codec();
+
+#ifdef USE_HOST
+    if (exit_when_done_) {
+      exit(0);
+    }
+#endif
+  }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_benchmark";
+  static constexpr uint16_t KNOWN_FINGER = 101;
+  static constexpr uint16_t UNKNOWN_FINGER = 999;
+  // Long enough for any cooldown and the lift reset to have happened
+  static constexpr uint32_t SETTLE_MS = 4000;
+  static constexpr uint32_t DECISION_TIMEOUT_MS = 5000;
+  static constexpr uint32_t POLL_PHASE_MS = 100;
+  static constexpr uint16_t DEEP_SLOT = 150;
+  static constexpr uint16_t HOT_SET_SIZE = 5;
+  // Matches before the first compaction run
+  static constexpr uint8_t WARMUP_TOUCHES = 3;
+  static constexpr uint32_t FAST_BAUD_RATE = 115200;
+  static constexpr uint32_t CODEC_ROUNDS = 100000;
+
+  struct Path {
+    const char *name;
+    uint16_t finger;
+    bool bad_image;
+    // Keep the finger down for hold_time and count everything that happens
+    bool hold;
+    uint16_t slot = 1;
+    uint16_t hot_set = 0;
+    uint32_t max_baud_rate = 0;
+  };
+
+  void run_path(const Path &path) {
+    VirtualClock clock;
+    MemoryStore store;
+    SensorEmulator emulator;
+    emulator.store_template(path.slot, KNOWN_FINGER);
+
+    FingerprintSensor sensor;
+    sensor.set_clock(&clock);
+    sensor.set_store(&store);
+    sensor.set_emulator(&emulator);
+    if (path.hot_set > 0) {
+      sensor.set_hot_set(path.hot_set, UINT32_MAX);
+    }
+    if (path.max_baud_rate > 0) {
+      sensor.set_max_baud_rate(path.max_baud_rate);
+    }
+    sensor.setup();
+    emulator.set_bad_image_rate(path.bad_image ? 1.0f : 0.0f);
+
+    if (path.hot_set > 0) {
+      // Let the known finger earn a score, then compact it into the hot range
+      for (uint8_t i = 0; i < WARMUP_TOUCHES; i++) {
+        emulator.place_finger(KNOWN_FINGER);
+        run_for(clock, sensor, SETTLE_MS);
+        emulator.lift_finger();
+        run_for(clock, sensor, SETTLE_MS);
+      }
+      sensor.compact_hot_set();
+      run_for(clock, sensor, SETTLE_MS);
+    }
+
+    bool decided = false;
+    uint32_t decided_at = 0;
+    uint32_t decisions = 0;
+    sensor.add_on_scan_result_callback([&](ScanResult, int, int) {
+      if (!decided) {
+        decided = true;
+        decided_at = clock.micros();
+      }
+      decisions++;
+    });
+
+    std::vector<uint32_t> latencies;
+    latencies.reserve(iterations_);
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    uint64_t round_trips = 0;
+    uint64_t led_commands = 0;
+    uint64_t total_decisions = 0;
+
+    for (uint32_t i = 0; i < iterations_; i++) {
+      emulator.lift_finger();
+      run_for(clock, sensor, SETTLE_MS + next_random() % POLL_PHASE_MS);
+
+      ProtocolStats before = sensor.get_protocol().stats();
+      uint32_t leds_before = sensor.get_led_manager().sent();
+      decided = false;
+      decisions = 0;
+      uint32_t touched_at = clock.micros();
+      uint32_t window_us = (path.hold ? hold_time_ms_ : DECISION_TIMEOUT_MS) * 1000;
+      emulator.place_finger(path.finger);
+      while (clock.micros() - touched_at < window_us && (path.hold || !decided)) {
+        step(clock, sensor);
+      }
+
+      if (decided) {
+        latencies.push_back(decided_at - touched_at);
+      }
+      const ProtocolStats &after = sensor.get_protocol().stats();
+      bytes_sent += after.bytes_sent - before.bytes_sent;
+      bytes_received += after.bytes_received - before.bytes_received;
+      round_trips += after.round_trips - before.round_trips;
+      led_commands += sensor.get_led_manager().sent() - leds_before;
+      total_decisions += decisions;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    float n = iterations_;
+    ESP_LOGI(TAG, "%-10s %6u %9.1f %9.1f %9.1f %8.0f %8.0f %7.1f %6.1f %9.2f", path.name,
+             (unsigned) latencies.size(), percentile(latencies, 0.50f), percentile(latencies, 0.99f),
+             percentile(latencies, 1.0f), bytes_sent / n, bytes_received / n, round_trips / n, led_commands / n,
+             total_decisions / n);
+  }
+
+  // Wall time to encode a search and to parse and decode its acknowledge, as on every scan
+  void run_codec() {
+    using std::chrono::steady_clock;
+    CommandFrame frame;
+    auto start = steady_clock::now();
+    for (uint32_t i = 0; i < CODEC_ROUNDS; i++) {
+      uint8_t *params = frame.params();
+      Search::Slot::put(params, 1);
+      Search::StartPage::put(params, i);
+      Search::PageCount::put(params, 200);
+      frame.seal<Search>(0xFFFFFFFF);
+      codec_sink_ = codec_sink_ + frame.data()[frame.size() - 1];
+    }
+    auto encoded = steady_clock::now();
+
+    PacketParser parser;
+    SensorPacket packet;
+    for (uint32_t i = 0; i < CODEC_ROUNDS; i++) {
+      for (uint8_t byte : fingerprint_sensor::reference_frames::SEARCH_ACK) {
+        if (parser.feed(byte, &packet) == PacketParser::COMPLETE) {
+          codec_sink_ = codec_sink_ + Search::FingerId::get(ack_results(packet)) +
+                        Search::Confidence::get(ack_results(packet));
+        }
+      }
+    }
+    auto decoded = steady_clock::now();
+
+    double encode_ns = std::chrono::duration<double, std::nano>(encoded - start).count() / CODEC_ROUNDS;
+    double decode_ns = std::chrono::duration<double, std::nano>(decoded - encoded).count() / CODEC_ROUNDS;
+    ESP_LOGI(TAG, "codec: %.1f ns per search encoded, %.1f ns per acknowledge decoded", encode_ns, decode_ns);
+  }
+
+  // One main loop pass: the component's own work, then idle up to the loop interval
+  void step(VirtualClock &clock, FingerprintSensor &sensor) {
+    uint32_t start = clock.micros();
+    sensor.loop();
+    uint32_t spent = clock.micros() - start;
+    if (spent < loop_interval_ms_ * 1000) {
+      clock.wait_us(loop_interval_ms_ * 1000 - spent);
+    }
+  }
+
+  void run_for(VirtualClock &clock, FingerprintSensor &sensor, uint32_t duration_ms) {
+    uint32_t start = clock.micros();
+    while (clock.micros() - start < duration_ms * 1000) {
+      step(clock, sensor);
+    }
+  }
+
+  static float percentile(const std::vector<uint32_t> &sorted_us, float fraction) {
+    if (sorted_us.empty()) {
+      return NAN;
+    }
+    size_t index = std::min(sorted_us.size() - 1, size_t(sorted_us.size() * fraction));
+    return sorted_us[index] / 1000.0f;
+  }
+
+  uint32_t next_random() {
+    rng_state_ ^= rng_state_ << 13;
+    rng_state_ ^= rng_state_ >> 17;
+    rng_state_ ^= rng_state_ << 5;
+    return rng_state_;
+  }
+
+  uint32_t iterations_ = 200;
+  uint32_t loop_interval_ms_ = 16;
+  uint32_t hold_time_ms_ = 5000;
+  bool exit_when_done_ = true;
+  uint32_t rng_state_ = 0x9E3779B9;
+  // Keeps the codec loops from being optimized away
+  volatile uint32_t codec_sink_ = 0;
+};
+
+}  // namespace fingerprint_benchmark
+}  // namespace esphome
@@ -0,0 +1,52 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import binary_sensor, fingerprint_sensor, text_sensor
+from esphome.const import CONF_ID, ENTITY_CATEGORY_DIAGNOSTIC
+
+DEPENDENCIES = ["fingerprint_sensor"]
+AUTO_LOAD = ["binary_sensor", "text_sensor"]
+CODEOWNERS = ["@yourusername"]
+# One per fingerprint_sensor
+MULTI_CONF = True
+
+fingerprint_pairing_ns = cg.esphome_ns.namespace("fingerprint_pairing")
+FingerprintPairing = fingerprint_pairing_ns.class_(
+    "FingerprintPairing", cg.PollingComponent
+)
+
+CONF_FINGERPRINT_SENSOR_ID = "fingerprint_sensor_id"
+CONF_PAIRING_VALID = "pairing_valid"
+CONF_PAIRING_WARNING = "pairing_warning"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(FingerprintPairing),
+        cv.GenerateID(CONF_FINGERPRINT_SENSOR_ID): cv.use_id(
+            fingerprint_sensor.FingerprintSensor
+        ),
+        cv.Optional(CONF_PAIRING_VALID): binary_sensor.binary_sensor_schema(
+            icon="mdi:link-lock",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_PAIRING_WARNING): text_sensor.text_sensor_schema(
+            icon="mdi:shield-alert",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+).extend(cv.polling_component_schema("1h"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    parent = await cg.get_variable(config[CONF_FINGERPRINT_SENSOR_ID])
+    cg.add(var.set_fingerprint_sensor(parent))
+
+    if CONF_PAIRING_VALID in config:
+        sens = await binary_sensor.new_binary_sensor(config[CONF_PAIRING_VALID])
+        cg.add(var.set_pairing_valid_sensor(sens))
+
+    if CONF_PAIRING_WARNING in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_PAIRING_WARNING])
+        cg.add(var.set_pairing_warning_sensor(sens))
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstring>
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "esphome/components/fingerprint_sensor/fingerprint_sensor.h"
+
+namespace esphome {
+namespace fingerprint_pairing {
+
+using fingerprint_sensor::ack_results;
+using fingerprint_sensor::BUS_PRIORITY_HIGH;
+using fingerprint_sensor::BUS_PRIORITY_NORMAL;
+using fingerprint_sensor::BusPriority;
+using fingerprint_sensor::CONFIRM_OK;
+using fingerprint_sensor::FingerprintSensor;
+using fingerprint_sensor::NOTEPAD_PAGE_SIZE;
+using fingerprint_sensor::ReadNotepad;
+using fingerprint_sensor::SensorPacket;
+using fingerprint_sensor::WriteNotepad;
+
+/**
+ * Binds the ESP to its fingerprint sensor.
+ *
+ * A random code is written to the sensor's notepad and kept in flash. If the
+ * sensor later returns a different code, it was swapped out and the pairing
+ * is invalidated until it is redone on purpose.
+ *
+ * All sensor access goes through the fingerprint sensor's shared bus, so it
+ * never interleaves with door scans.
+ *
+ * Matches are gated on the stored verdict, which the sensor reads without a
+ * round trip. Every connection, boot included, may bring a different sensor,
+ * so from then on matches stay blocked until the notepad has been read back
+ * and holds our code. A failed read counts as a failed check and is retried;
+ * a sensor without a notepad never gets to open the door.
+ */
+class FingerprintPairing : public PollingComponent {
+ public:
+  void set_fingerprint_sensor(FingerprintSensor *sensor) { sensor_ = sensor; }
+  void set_pairing_valid_sensor(binary_sensor::BinarySensor *sensor) { pairing_valid_sensor_ = sensor; }
+  void set_pairing_warning_sensor(text_sensor::TextSensor *sensor) { pairing_warning_sensor_ = sensor; }
+
+  bool is_paired() const { return record_.valid; }
+
+  void setup() override {
+    // Each door keeps its own code; the first one under the key it always had
+    std::string key = "fingerprint_pairing";
+    if (strcmp(sensor_->get_storage_namespace(), "fingerprints") != 0) {
+      key.append("_").append(sensor_->get_storage_namespace());
+    }
+    pref_ = global_preferences->make_preference<PairingRecord>(fnv1_hash(key));
+    if (!pref_.load(&record_)) {
+      record_ = PairingRecord{};
+    }
+    update_gate();
+
+    // A library backup carries the code, so a restored door keeps its pairing
+    sensor_->add_backup_section(
+        "pairing",
+        [this]() { return record_.valid ? std::string(record_.code, NOTEPAD_PAGE_SIZE) : std::string(); },
+        [this](const std::string &code) { restore_pairing(code); });
+
+    // Any sensor that answers, at boot or after a dropout, may be a different one.
+    // Checked ahead of other bus users, so the window on the stored verdict stays short.
+    sensor_->add_on_connected_callback([this]() {
+      verified_ = false;
+      update_gate();
+      if (!busy_) {
+        check_pairing(BUS_PRIORITY_HIGH);
+      }
+    });
+
+    if (record_.code[0] == 0) {
+      ESP_LOGW(TAG, "No pairing code stored - first boot. Will auto-pair.");
+      do_pairing();
+    } else if (!record_.valid) {
+      publish_invalid();
+    }
+  }
+
+  void update() override { check_pairing(); }
+
+  /**
+   * Perform pairing with sensor
+   */
+  void do_pairing() {
+    ESP_LOGI(TAG, "Starting pairing process...");
+
+    // Random code, hex encoded so it fills the notepad page exactly
+    uint8_t random[NOTEPAD_PAGE_SIZE / 2];
+    random_bytes(random, sizeof(random));
+    std::string code = format_hex(random, sizeof(random));
+    ESP_LOGD(TAG, "Generated pairing code: %s", code.c_str());
+    write_code(code);
+  }
+
+  /**
+   * Check if current pairing is valid
+   */
+  void check_pairing(BusPriority priority = BUS_PRIORITY_NORMAL) {
+    // If never paired, do automatic pairing
+    if (record_.code[0] == 0) {
+      ESP_LOGW(TAG, "No stored pairing code - performing initial pairing");
+      do_pairing();
+      return;
+    }
+
+    // If previously invalidated, don't auto-pair
+    if (!record_.valid) {
+      ESP_LOGW(TAG, "Pairing was invalidated previously");
+      publish_invalid();
+      return;
+    }
+    if (busy_) {
+      return;
+    }
+
+    ESP_LOGD(TAG, "Checking pairing status...");
+    uint8_t params[ReadNotepad::REQUEST];
+    ReadNotepad::Page::put(params, PAIRING_PAGE);
+    submit<ReadNotepad>(priority, params, [this](uint8_t result, const SensorPacket &reply) {
+      if (result != CONFIRM_OK) {
+        // Don't invalidate on communication error - might be temporary. Until
+        // a read succeeds we don't know which sensor this is, though.
+        ESP_LOGW(TAG, "Could not read pairing code from sensor (error: %d)", result);
+        verified_ = false;
+        update_gate();
+        publish_warning("Pairing could not be checked - fingerprint matches are blocked until it is");
+        this->set_timeout("check_pairing", VERIFY_RETRY_MS, [this]() {
+          if (sensor_->is_connected()) {
+            check_pairing(BUS_PRIORITY_HIGH);
+          }
+        });
+        return;
+      }
+
+      if (memcmp(ReadNotepad::Data::at(ack_results(reply)), record_.code, NOTEPAD_PAGE_SIZE) == 0) {
+        ESP_LOGD(TAG, "Pairing valid - codes match");
+        verified_ = true;
+        update_gate();
+        if (pairing_valid_sensor_ != nullptr) {
+          pairing_valid_sensor_->publish_state(true);
+        }
+        publish_warning("");
+        return;
+      }
+
+      // SECURITY ISSUE: Codes don't match!
+      ESP_LOGE(TAG, "SECURITY WARNING: Pairing codes don't match!");
+      record_.valid = false;
+      pref_.save(&record_);
+      update_gate();
+      if (pairing_valid_sensor_ != nullptr) {
+        pairing_valid_sensor_->publish_state(false);
+      }
+      publish_warning("SECURITY ALERT: Sensor pairing mismatch! Possible attack or sensor replacement detected. "
+                      "Fingerprint matches will be blocked. If you replaced the sensor, do re-pairing.");
+    });
+  }
+
+  // Take over the code of a restored backup and write it to the attached sensor
+  void restore_pairing(const std::string &code) {
+    if (code.size() != NOTEPAD_PAGE_SIZE) {
+      ESP_LOGW(TAG, "Backup carries no pairing code, keeping the current pairing");
+      return;
+    }
+    ESP_LOGI(TAG, "Restoring pairing from backup");
+    write_code(code);
+  }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_pairing";
+  static constexpr uint8_t PAIRING_PAGE = 0;
+  // Until a failed check is tried again
+  static constexpr uint32_t VERIFY_RETRY_MS = 5000;
+
+  struct PairingRecord {
+    // Not NUL-terminated when full, an empty code means never paired
+    char code[NOTEPAD_PAGE_SIZE] = {0};
+    bool valid = false;
+  };
+
+  // Store the code on the sensor, and in flash once the sensor has it
+  void write_code(const std::string &code) {
+    if (busy_) {
+      ESP_LOGW(TAG, "Pairing request already in progress");
+      return;
+    }
+    uint8_t params[WriteNotepad::REQUEST];
+    WriteNotepad::Page::put(params, PAIRING_PAGE);
+    memcpy(WriteNotepad::Data::at(params), code.data(), NOTEPAD_PAGE_SIZE);
+    submit<WriteNotepad>(BUS_PRIORITY_NORMAL, params, [this, code](uint8_t result, const SensorPacket &) {
+      if (result != CONFIRM_OK) {
+        ESP_LOGE(TAG, "Pairing failed - could not write to sensor (error: %d)", result);
+        publish_warning("Pairing failed - check sensor connection");
+        return;
+      }
+      memcpy(record_.code, code.data(), NOTEPAD_PAGE_SIZE);
+      record_.valid = true;
+      pref_.save(&record_);
+      // The sensor just took our code, it is the one we are paired with
+      verified_ = true;
+      update_gate();
+
+      ESP_LOGI(TAG, "Pairing successful!");
+      if (pairing_valid_sensor_ != nullptr) {
+        pairing_valid_sensor_->publish_state(true);
+      }
+      publish_warning("Pairing successful");
+    });
+  }
+
+  // Block matches on a known mismatch and on a sensor not yet checked since it
+  // connected. Never paired is not invalid: the first pairing is on its way.
+  void update_gate() { sensor_->set_matches_blocked(record_.code[0] != 0 && (!record_.valid || !verified_)); }
+
+  template<typename C, typename F> void submit(BusPriority priority, const uint8_t *params, F &&callback) {
+    busy_ = true;
+    bool queued = sensor_->get_bus()->submit<C>(priority, params,
+                                                [this, callback](uint8_t result, const SensorPacket &reply) {
+                                                  busy_ = false;
+                                                  callback(result, reply);
+                                                });
+    if (!queued) {
+      busy_ = false;
+      ESP_LOGW(TAG, "Sensor command queue is full, try again later");
+    }
+  }
+
+  void publish_invalid() {
+    if (pairing_valid_sensor_ != nullptr) {
+      pairing_valid_sensor_->publish_state(false);
+    }
+    publish_warning("SECURITY: Pairing invalid! Sensor may have been replaced. Do re-pairing.");
+  }
+
+  void publish_warning(const char *message) {
+    if (pairing_warning_sensor_ != nullptr) {
+      pairing_warning_sensor_->publish_state(message);
+    }
+  }
+
+  FingerprintSensor *sensor_{nullptr};
+  binary_sensor::BinarySensor *pairing_valid_sensor_{nullptr};
+  text_sensor::TextSensor *pairing_warning_sensor_{nullptr};
+  ESPPreferenceObject pref_;
+  PairingRecord record_;
+  // A command of ours is waiting in the bus queue
+  bool busy_ = false;
+  // The connected sensor returned our code since it connected
+  bool verified_ = false;
+};
+
+}  // namespace fingerprint_pairing
+}  // namespace esphome
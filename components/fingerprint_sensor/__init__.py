@@ -1,32 +1,349 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import uart, sensor, text_sensor, binary_sensor
+import esphome.final_validate as fv
+from esphome import automation, pins
+from esphome.components import uart, sensor, text_sensor, binary_sensor, switch
+from esphome.components import time as time_
+from esphome.components.esp32 import add_idf_sdkconfig_option
 from esphome.const import (
+    CONF_COLOR,
+    CONF_COUNT,
     CONF_ID,
+    CONF_MODE,
+    CONF_SIZE,
+    CONF_SPEED,
+    CONF_TIME_ID,
+    CONF_TRIGGER_ID,
+    CONF_UPDATE_INTERVAL,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
 )
+from esphome.core import CORE, ID
 
 DEPENDENCIES = ["uart"]
 AUTO_LOAD = ["sensor", "text_sensor", "binary_sensor"]
 CODEOWNERS = ["@yourusername"]
+# One per door, each on its own uart
+MULTI_CONF = True
+DOMAIN = "fingerprint_sensor"
 
 # Define the namespace
 fingerprint_sensor_ns = cg.esphome_ns.namespace("fingerprint_sensor")
 FingerprintSensor = fingerprint_sensor_ns.class_(
     "FingerprintSensor", cg.Component, uart.UARTDevice
 )
+SensorEmulator = fingerprint_sensor_ns.class_("SensorEmulator")
+SensorScheduler = fingerprint_sensor_ns.class_("SensorScheduler")
+BackupChunkTrigger = fingerprint_sensor_ns.class_(
+    "BackupChunkTrigger",
+    automation.Trigger.template(
+        cg.std_string, cg.int_, cg.int_, cg.std_string, cg.uint32
+    ),
+)
+RestoreProgressTrigger = fingerprint_sensor_ns.class_(
+    "RestoreProgressTrigger", automation.Trigger.template(cg.int_, cg.bool_)
+)
+AccessLogBatchTrigger = fingerprint_sensor_ns.class_(
+    "AccessLogBatchTrigger",
+    automation.Trigger.template(cg.std_string, cg.uint32, cg.int_),
+)
 
 # Configuration keys
 CONF_MATCH_ID = "match_id"
 CONF_MATCH_NAME = "match_name"
+CONF_MATCH_EVENT = "match_event"
+CONF_BATCH_WINDOW = "batch_window"
 CONF_CONFIDENCE = "confidence"
 CONF_ENROLLED_COUNT = "enrolled_count"
 CONF_STATUS = "status"
 CONF_RING = "ring"
+CONF_LOOP_TIME = "loop_time"
+CONF_QUEUE_DEPTH = "queue_depth"
+CONF_UART_ERRORS = "uart_errors"
+CONF_HEAP_FREE = "heap_free"
+CONF_HEAP_MAX_BLOCK = "heap_max_block"
+CONF_MAX_BAUD_RATE = "max_baud_rate"
+CONF_LINK_RATE = "link_rate"
+CONF_ROUND_TRIP = "round_trip"
+CONF_MATCH_COOLDOWN = "match_cooldown"
+CONF_RING_COOLDOWN = "ring_cooldown"
+CONF_ENROLL_PROGRESS = "enroll_progress"
+CONF_ENROLL_TIMEOUT = "enroll_timeout"
+CONF_TOUCH_PIN = "touch_pin"
+CONF_IGNORE_TOUCH_RING = "ignore_touch_ring"
+CONF_STAGE_TIMING = "stage_timing"
+CONF_SENSOR_TASK = "sensor_task"
+CONF_TASK_CORE = "core"
+CONF_TASK_PRIORITY = "priority"
+CONF_LED_PROFILES = "led_profiles"
+CONF_HOT_SET = "hot_set"
+CONF_ON_BACKUP_CHUNK = "on_backup_chunk"
+CONF_ON_RESTORE_PROGRESS = "on_restore_progress"
+CONF_COMPACTION_INTERVAL = "compaction_interval"
+CONF_EMULATOR = "emulator"
+CONF_STORAGE_NAMESPACE = "storage_namespace"
+CONF_POWER_SAVE = "power_save"
+CONF_IDLE_AFTER = "idle_after"
+CONF_MAX_SLEEP = "max_sleep"
+CONF_AWAKE = "awake"
+CONF_WAKEUPS = "wakeups"
+CONF_WAKE_LATENCY = "wake_latency"
+CONF_ACCESS_LOG = "access_log"
+CONF_BURST = "burst"
+CONF_ATTEMPTS = "attempts"
+CONF_TIME_BUDGET = "time_budget"
+CONF_RETRIES = "retries"
+CONF_RESCUED = "rescued"
+CONF_PAGES = "pages"
+CONF_FLUSH_INTERVAL = "flush_interval"
+CONF_FLASH_WRITTEN = "flash_written"
+CONF_ON_BATCH = "on_batch"
+CONF_CAPACITY = "capacity"
+CONF_MODEL = "model"
+CONF_ERROR_RATE = "error_rate"
+CONF_BAD_IMAGE_RATE = "bad_image_rate"
+CONF_FALSE_REJECT_RATE = "false_reject_rate"
+CONF_SEED = "seed"
+CONF_TEMPLATES = "templates"
+CONF_GET_IMAGE_TIME = "get_image_time"
+CONF_IMAGE2TZ_TIME = "image2tz_time"
+CONF_SEARCH_TIME = "search_time"
+CONF_STORE_TIME = "store_time"
+
+# Sensor models: C++ profile, capacity, whether it has the LED ring
+SENSOR_MODELS = {
+    "R503": (fingerprint_sensor_ns.struct("R503Profile"), 200, True),
+    "R307": (fingerprint_sensor_ns.struct("R307Profile"), 1000, False),
+    "AS608": (fingerprint_sensor_ns.struct("AS608Profile"), 300, False),
+}
+# Rate every supported model starts at (BAUD_RATE in sensor_profile.h)
+DEFAULT_BAUD_RATE = 57600
+# Rates the sensors' baud rate register can hold
+BAUD_RATES = [9600, 19200, 38400, 57600, 115200]
+
+# Instrumented stages, in the order of the C++ Stage enum
+STAGES = [
+    "get_image",
+    "image2tz",
+    "search",
+    "led",
+    "publish",
+    "enroll_image",
+    "enroll_convert",
+    "enroll_model",
+]
+# Published statistics, in the order of the C++ StageStatistic enum
+STAGE_STATISTICS = ["p50", "p95", "max"]
+
+STAGE_TIMING_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_UPDATE_INTERVAL, default="60s"): cv.update_interval,
+        **{
+            cv.Optional(stage): cv.Schema(
+                {
+                    cv.Optional(statistic): sensor.sensor_schema(
+                        icon="mdi:timer-outline",
+                        accuracy_decimals=1,
+                        unit_of_measurement=UNIT_MILLISECOND,
+                        state_class=STATE_CLASS_MEASUREMENT,
+                        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+                    )
+                    for statistic in STAGE_STATISTICS
+                }
+            )
+            for stage in STAGES
+        },
+    }
+)
+
+# LED events, in the order of the C++ LedEvent enum
+LED_EVENTS = [
+    "ready",
+    "scanning",
+    "match",
+    "ring",
+    "error",
+    "enroll_place",
+    "enroll_lift",
+    "enroll_pass",
+    "sleep",
+]
+# AuraLED control codes
+LED_MODES = {
+    "breathing": 0x01,
+    "flashing": 0x02,
+    "on": 0x03,
+    "off": 0x04,
+    "gradual_on": 0x05,
+    "gradual_off": 0x06,
+}
+LED_COLORS = {
+    "red": 0x01,
+    "blue": 0x02,
+    "purple": 0x03,
+}
+
+LED_PROFILE_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_MODE): cv.enum(LED_MODES, lower=True),
+        cv.Optional(CONF_COLOR, default="blue"): cv.enum(LED_COLORS, lower=True),
+        cv.Optional(CONF_SPEED, default=0): cv.uint8_t,
+        # Number of cycles for breathing/flashing, 0 = forever
+        cv.Optional(CONF_COUNT, default=0): cv.uint8_t,
+    }
+)
+
+# Scan from a pinned FreeRTOS task, off the main loop. The main loop
+# (Arduino) runs on core 1, so core 0 takes the sensor by default.
+SENSOR_TASK_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_TASK_CORE, default=0): cv.int_range(min=0, max=1),
+            cv.Optional(CONF_TASK_PRIORITY, default=5): cv.int_range(min=1, max=24),
+        }
+    ),
+    cv.only_on_esp32,
+)
+
+# Light sleep while idle, woken by the touch ring. ESP-IDF's automatic light
+# sleep keeps Wi-Fi in modem sleep, naps are capped at max_sleep so the other
+# components get their loop passes.
+POWER_SAVE_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(
+                CONF_IDLE_AFTER, default="5s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MAX_SLEEP, default="1s"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(max=cv.TimePeriod(seconds=10)),
+            ),
+            cv.Optional(CONF_UPDATE_INTERVAL, default="60s"): cv.update_interval,
+            # Share of each window spent awake, a stand-in for idle current
+            cv.Optional(CONF_AWAKE): sensor.sensor_schema(
+                icon="mdi:sleep-off",
+                accuracy_decimals=1,
+                unit_of_measurement=UNIT_PERCENT,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_WAKEUPS): sensor.sensor_schema(
+                icon="mdi:alarm",
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            # Median time from a touch wake to its decision
+            cv.Optional(CONF_WAKE_LATENCY): sensor.sensor_schema(
+                icon="mdi:timer-outline",
+                accuracy_decimals=1,
+                unit_of_measurement=UNIT_MILLISECOND,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+        }
+    ),
+    cv.only_on_esp32,
+    # Needs power management and tickless idle in sdkconfig
+    cv.only_with_esp_idf,
+)
+
+# Several images per touch while the finger stays down: a bad image or a
+# search without a match takes another one, the doorbell only rings once
+# every attempt failed or the time budget since the first image is spent
+BURST_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_ATTEMPTS, default=3): cv.int_range(min=1, max=10),
+        cv.Optional(
+            CONF_TIME_BUDGET, default="1500ms"
+        ): cv.positive_time_period_milliseconds,
+        # Images taken after the first, per decision
+        cv.Optional(CONF_RETRIES): sensor.sensor_schema(
+            icon="mdi:camera-burst",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Matches since boot that only a retry found
+        cv.Optional(CONF_RESCUED): sensor.sensor_schema(
+            icon="mdi:account-check",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+# Decisions kept in flash until uploaded. Pages of 32 records are staged in
+# RAM and written when full, every flush_interval and at shutdown.
+ACCESS_LOG_SCHEMA = cv.Schema(
+    {
+        # 16 pages take about 6 kB of the NVS partition, see _validate_nvs_budget
+        cv.Optional(CONF_PAGES, default=8): cv.int_range(min=2, max=16),
+        cv.Optional(
+            CONF_FLUSH_INTERVAL, default="10min"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_UPDATE_INTERVAL, default="60s"): cv.update_interval,
+        # Bytes the log wrote to flash today, starting over every 24 hours
+        cv.Optional(CONF_FLASH_WRITTEN): sensor.sensor_schema(
+            icon="mdi:content-save-move",
+            accuracy_decimals=0,
+            unit_of_measurement=UNIT_BYTES,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_ON_BATCH): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(AccessLogBatchTrigger),
+            }
+        ),
+    }
+)
+
+# Search the most used templates first and keep them in the lowest slots
+HOT_SET_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SIZE, default=5): cv.int_range(min=1, max=50),
+        cv.Optional(
+            CONF_COMPACTION_INTERVAL, default="10min"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+# Protocol-level stand-in for the sensor, for running without hardware
+EMULATOR_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(SensorEmulator),
+        # The model's capacity unless set
+        cv.Optional(CONF_CAPACITY): cv.int_range(min=1, max=1000),
+        cv.Optional(CONF_ERROR_RATE, default=0.0): cv.percentage,
+        cv.Optional(CONF_BAD_IMAGE_RATE, default=0.0): cv.percentage,
+        cv.Optional(CONF_FALSE_REJECT_RATE, default=0.0): cv.percentage,
+        cv.Optional(CONF_SEED, default=1): cv.uint32_t,
+        # Pre-enrolled library: slot -> finger token
+        cv.Optional(CONF_TEMPLATES, default={}): cv.Schema(
+            {cv.int_range(min=0, max=999): cv.int_range(min=1, max=65534)}
+        ),
+        cv.Optional(CONF_GET_IMAGE_TIME): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_IMAGE2TZ_TIME): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_SEARCH_TIME): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_STORE_TIME): cv.positive_time_period_milliseconds,
+    }
+)
 
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(FingerprintSensor),
+        # Sets capacity, enrollment passes, baud rate and scan interval
+        cv.Optional(CONF_MODEL, default="R503"): cv.one_of(*SENSOR_MODELS, upper=True),
+        # NVS namespace of this reader's names and settings (15 characters at most)
+        cv.Optional(CONF_STORAGE_NAMESPACE, default="fingerprints"): cv.All(
+            cv.string_strict, cv.Length(min=1, max=15)
+        ),
         cv.Optional(CONF_MATCH_ID): sensor.sensor_schema(
             icon="mdi:fingerprint",
             accuracy_decimals=0,
@@ -34,6 +351,18 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_MATCH_NAME): text_sensor.text_sensor_schema(
             icon="mdi:account",
         ),
+        # Every decision as one JSON state, instead of match_id, match_name,
+        # confidence, ring and status one by one
+        cv.Optional(CONF_MATCH_EVENT): text_sensor.text_sensor_schema(
+            icon="mdi:fingerprint",
+        ).extend(
+            {
+                cv.Optional(
+                    CONF_BATCH_WINDOW, default="500ms"
+                ): cv.positive_time_period_milliseconds,
+            }
+        ),
+        cv.Optional(CONF_TIME_ID): cv.use_id(time_.RealTimeClock),
         cv.Optional(CONF_CONFIDENCE): sensor.sensor_schema(
             icon="mdi:percent",
             accuracy_decimals=0,
@@ -49,14 +378,221 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_RING): binary_sensor.binary_sensor_schema(
             icon="mdi:doorbell",
         ),
+        cv.Optional(CONF_LOOP_TIME): sensor.sensor_schema(
+            icon="mdi:timer-outline",
+            accuracy_decimals=1,
+            unit_of_measurement=UNIT_MILLISECOND,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Deepest the shared command queue got in each 10 s window
+        cv.Optional(CONF_QUEUE_DEPTH): sensor.sensor_schema(
+            icon="mdi:tray-full",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Timeouts and corrupted replies since boot
+        cv.Optional(CONF_UART_ERRORS): sensor.sensor_schema(
+            icon="mdi:alert-circle-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Free heap and largest free block, to keep an eye on fragmentation
+        cv.Optional(CONF_HEAP_FREE): sensor.sensor_schema(
+            icon="mdi:memory",
+            accuracy_decimals=0,
+            unit_of_measurement=UNIT_BYTES,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_HEAP_MAX_BLOCK): sensor.sensor_schema(
+            icon="mdi:memory",
+            accuracy_decimals=0,
+            unit_of_measurement=UNIT_BYTES,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Negotiate this rate with the sensor, falling back to 57600 if the link
+        # isn't clean at it. The uart baud_rate stays at the sensor's 57600.
+        cv.Optional(CONF_MAX_BAUD_RATE): cv.one_of(*BAUD_RATES, int=True),
+        cv.Optional(CONF_LINK_RATE): sensor.sensor_schema(
+            icon="mdi:speedometer",
+            accuracy_decimals=0,
+            unit_of_measurement="Bd",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Mean verifyPassword() round trip, measured at every connection
+        cv.Optional(CONF_ROUND_TRIP): sensor.sensor_schema(
+            icon="mdi:timer-outline",
+            accuracy_decimals=2,
+            unit_of_measurement=UNIT_MILLISECOND,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(
+            CONF_MATCH_COOLDOWN, default="3s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(
+            CONF_RING_COOLDOWN, default="1s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_ENROLL_PROGRESS): sensor.sensor_schema(
+            icon="mdi:progress-check",
+            accuracy_decimals=0,
+            unit_of_measurement=UNIT_PERCENT,
+        ),
+        cv.Optional(
+            CONF_ENROLL_TIMEOUT, default="30s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_TOUCH_PIN): pins.internal_gpio_input_pin_schema,
+        cv.Optional(CONF_SENSOR_TASK): SENSOR_TASK_SCHEMA,
+        cv.Optional(CONF_POWER_SAVE): POWER_SAVE_SCHEMA,
+        cv.Optional(CONF_ACCESS_LOG): ACCESS_LOG_SCHEMA,
+        cv.Optional(CONF_BURST): BURST_SCHEMA,
+        cv.Optional(CONF_HOT_SET): HOT_SET_SCHEMA,
+        cv.Optional(CONF_IGNORE_TOUCH_RING): cv.use_id(switch.Switch),
+        cv.Optional(CONF_STAGE_TIMING): STAGE_TIMING_SCHEMA,
+        cv.Optional(CONF_LED_PROFILES): cv.Schema(
+            {cv.Optional(event): LED_PROFILE_SCHEMA for event in LED_EVENTS}
+        ),
+        cv.Optional(CONF_EMULATOR): EMULATOR_SCHEMA,
+        cv.Optional(CONF_ON_BACKUP_CHUNK): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(BackupChunkTrigger),
+            }
+        ),
+        cv.Optional(CONF_ON_RESTORE_PROGRESS): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(RestoreProgressTrigger),
+            }
+        ),
     }
 ).extend(cv.COMPONENT_SCHEMA).extend(uart.UART_DEVICE_SCHEMA)
 
 
+def _validate_power_save(config):
+    if CONF_POWER_SAVE in config and CONF_TOUCH_PIN not in config:
+        raise cv.Invalid(
+            "power_save wakes up on the touch ring, touch_pin is required",
+            path=[CONF_POWER_SAVE],
+        )
+    return config
+
+
+def _validate_model(config):
+    if CONF_LED_PROFILES in config and not SENSOR_MODELS[config[CONF_MODEL]][2]:
+        raise cv.Invalid(
+            f"The {config[CONF_MODEL]} has no LED ring to show led_profiles on",
+            path=[CONF_LED_PROFILES],
+        )
+    return config
+
+
+def _validate_max_baud_rate(config):
+    if config.get(CONF_MAX_BAUD_RATE, DEFAULT_BAUD_RATE) < DEFAULT_BAUD_RATE:
+        raise cv.Invalid(
+            f"max_baud_rate only ever raises the link above the sensor's "
+            f"{DEFAULT_BAUD_RATE} baud, use {DEFAULT_BAUD_RATE} or more",
+            path=[CONF_MAX_BAUD_RATE],
+        )
+    return config
+
+
+# NVS stores values in 32 byte entries, a blob takes two more for its headers
+NVS_ENTRY_SIZE = 32
+# ESPHome's default partition table has 20 kB of NVS: 5 pages of 126 entries,
+# one of them kept free for garbage collection
+NVS_ENTRIES = 4 * 126
+# Share of it the access log and the slot map may take; names, pairing and
+# ESPHome's own preferences live there too
+NVS_BUDGET_ENTRIES = NVS_ENTRIES // 2
+# Sizes in access_log.h and hot_set.h
+ACCESS_LOG_PAGE_SIZE = 12 + 32 * 9 + 4
+HOT_SET_HEADER_SIZE = 12 + 4
+
+
+def _nvs_entries(size):
+    return 2 + (size + NVS_ENTRY_SIZE - 1) // NVS_ENTRY_SIZE
+
+
+def _validate_nvs_budget(config):
+    if CONF_ACCESS_LOG not in config:
+        return config
+    pages = config[CONF_ACCESS_LOG][CONF_PAGES]
+    entries = pages * _nvs_entries(ACCESS_LOG_PAGE_SIZE)
+    if CONF_HOT_SET in config:
+        # Two copies of the slot map, 4 bytes per slot
+        capacity = SENSOR_MODELS[config[CONF_MODEL]][1]
+        entries += 2 * _nvs_entries(HOT_SET_HEADER_SIZE + 4 * capacity)
+    if entries > NVS_BUDGET_ENTRIES:
+        raise cv.Invalid(
+            f"access_log with {pages} pages"
+            + (" and the hot_set slot map" if CONF_HOT_SET in config else "")
+            + f" needs about {entries * NVS_ENTRY_SIZE // 1024} kB of NVS, more than "
+            f"{NVS_BUDGET_ENTRIES * NVS_ENTRY_SIZE // 1024} kB leave room for names "
+            "and settings in the 20 kB partition, use fewer pages or no hot_set",
+            path=[CONF_ACCESS_LOG, CONF_PAGES],
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    CONFIG_SCHEMA,
+    _validate_power_save,
+    _validate_model,
+    _validate_max_baud_rate,
+    _validate_nvs_budget,
+)
+
+
+def _final_validate(config):
+    full_config = fv.full_config.get()
+    namespaces = [conf[CONF_STORAGE_NAMESPACE] for conf in full_config[DOMAIN]]
+    if (
+        CONF_POWER_SAVE in config
+        and "wifi" in full_config
+        and str(full_config["wifi"].get("power_save_mode", "LIGHT")).upper() == "NONE"
+    ):
+        raise cv.Invalid(
+            "power_save needs Wi-Fi modem sleep to keep the connection through light "
+            "sleep, set wifi power_save_mode to LIGHT or HIGH",
+            path=[CONF_POWER_SAVE],
+        )
+    if CONF_POWER_SAVE in config and len(namespaces) > 1:
+        raise cv.Invalid(
+            "power_save sleeps the whole ESP, it only works with a single fingerprint_sensor",
+            path=[CONF_POWER_SAVE],
+        )
+    if namespaces.count(config[CONF_STORAGE_NAMESPACE]) > 1:
+        raise cv.Invalid(
+            f"Storage namespace '{config[CONF_STORAGE_NAMESPACE]}' is used by more "
+            "than one fingerprint_sensor, each reader needs its own",
+            path=[CONF_STORAGE_NAMESPACE],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
+def _shared_scheduler():
+    # All readers of this node take turns on the one main loop
+    data = CORE.data.setdefault(DOMAIN, {})
+    if "scheduler" not in data:
+        data["scheduler"] = cg.new_Pvariable(
+            ID(f"{DOMAIN}_scheduler", is_declaration=True, type=SensorScheduler)
+        )
+    return data["scheduler"]
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await uart.register_uart_device(var, config)
+    cg.add(var.set_scheduler(_shared_scheduler()))
+    cg.add(var.set_storage_namespace(config[CONF_STORAGE_NAMESPACE]))
+    profile, capacity, _ = SENSOR_MODELS[config[CONF_MODEL]]
+    cg.add(var.set_model.template(profile)())
 
     # Register sensors
     if CONF_MATCH_ID in config:
@@ -67,6 +603,16 @@ async def to_code(config):
         sens = await text_sensor.new_text_sensor(config[CONF_MATCH_NAME])
         cg.add(var.set_match_name_sensor(sens))
 
+    if CONF_MATCH_EVENT in config:
+        conf = config[CONF_MATCH_EVENT]
+        sens = await text_sensor.new_text_sensor(conf)
+        cg.add(var.set_match_event_sensor(sens))
+        cg.add(var.set_match_event_window(conf[CONF_BATCH_WINDOW]))
+
+    if CONF_TIME_ID in config:
+        clock = await cg.get_variable(config[CONF_TIME_ID])
+        cg.add(var.set_time(clock))
+
     if CONF_CONFIDENCE in config:
         sens = await sensor.new_sensor(config[CONF_CONFIDENCE])
         cg.add(var.set_confidence_sensor(sens))
@@ -83,4 +629,166 @@ async def to_code(config):
         sens = await binary_sensor.new_binary_sensor(config[CONF_RING])
         cg.add(var.set_ring_sensor(sens))
 
+    if CONF_LOOP_TIME in config:
+        sens = await sensor.new_sensor(config[CONF_LOOP_TIME])
+        cg.add(var.set_loop_time_sensor(sens))
+
+    if CONF_QUEUE_DEPTH in config:
+        sens = await sensor.new_sensor(config[CONF_QUEUE_DEPTH])
+        cg.add(var.set_queue_depth_sensor(sens))
+
+    if CONF_UART_ERRORS in config:
+        sens = await sensor.new_sensor(config[CONF_UART_ERRORS])
+        cg.add(var.set_uart_errors_sensor(sens))
+
+    if CONF_HEAP_FREE in config:
+        sens = await sensor.new_sensor(config[CONF_HEAP_FREE])
+        cg.add(var.set_heap_free_sensor(sens))
+
+    if CONF_HEAP_MAX_BLOCK in config:
+        sens = await sensor.new_sensor(config[CONF_HEAP_MAX_BLOCK])
+        cg.add(var.set_heap_max_block_sensor(sens))
+
+    if CONF_MAX_BAUD_RATE in config:
+        cg.add(var.set_max_baud_rate(config[CONF_MAX_BAUD_RATE]))
+
+    if CONF_LINK_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_LINK_RATE])
+        cg.add(var.set_link_rate_sensor(sens))
+
+    if CONF_ROUND_TRIP in config:
+        sens = await sensor.new_sensor(config[CONF_ROUND_TRIP])
+        cg.add(var.set_round_trip_sensor(sens))
+
+    cg.add(var.set_match_cooldown(config[CONF_MATCH_COOLDOWN]))
+    cg.add(var.set_ring_cooldown(config[CONF_RING_COOLDOWN]))
+
+    if CONF_ENROLL_PROGRESS in config:
+        sens = await sensor.new_sensor(config[CONF_ENROLL_PROGRESS])
+        cg.add(var.set_enroll_progress_sensor(sens))
+
+    cg.add(var.set_enroll_timeout(config[CONF_ENROLL_TIMEOUT]))
+
+    if CONF_TOUCH_PIN in config:
+        pin = await cg.gpio_pin_expression(config[CONF_TOUCH_PIN])
+        cg.add(var.set_touch_pin(pin))
+
+    if CONF_SENSOR_TASK in config:
+        conf = config[CONF_SENSOR_TASK]
+        cg.add(var.set_sensor_task(conf[CONF_TASK_CORE], conf[CONF_TASK_PRIORITY]))
+
+    if CONF_POWER_SAVE in config:
+        conf = config[CONF_POWER_SAVE]
+        cg.add(var.set_power_save(conf[CONF_IDLE_AFTER], conf[CONF_MAX_SLEEP]))
+        cg.add(var.set_power_save_interval(conf[CONF_UPDATE_INTERVAL]))
+        add_idf_sdkconfig_option("CONFIG_PM_ENABLE", True)
+        add_idf_sdkconfig_option("CONFIG_FREERTOS_USE_TICKLESS_IDLE", True)
+        if CONF_AWAKE in conf:
+            sens = await sensor.new_sensor(conf[CONF_AWAKE])
+            cg.add(var.set_awake_sensor(sens))
+        if CONF_WAKEUPS in conf:
+            sens = await sensor.new_sensor(conf[CONF_WAKEUPS])
+            cg.add(var.set_wakeups_sensor(sens))
+        if CONF_WAKE_LATENCY in conf:
+            sens = await sensor.new_sensor(conf[CONF_WAKE_LATENCY])
+            cg.add(var.set_wake_latency_sensor(sens))
+
+    if CONF_BURST in config:
+        conf = config[CONF_BURST]
+        cg.add(var.set_burst(conf[CONF_ATTEMPTS], conf[CONF_TIME_BUDGET]))
+        if CONF_RETRIES in conf:
+            sens = await sensor.new_sensor(conf[CONF_RETRIES])
+            cg.add(var.set_burst_retries_sensor(sens))
+        if CONF_RESCUED in conf:
+            sens = await sensor.new_sensor(conf[CONF_RESCUED])
+            cg.add(var.set_burst_rescued_sensor(sens))
+
+    if CONF_ACCESS_LOG in config:
+        conf = config[CONF_ACCESS_LOG]
+        cg.add(var.set_access_log(conf[CONF_PAGES], conf[CONF_FLUSH_INTERVAL]))
+        cg.add(var.set_access_log_interval(conf[CONF_UPDATE_INTERVAL]))
+        if CONF_FLASH_WRITTEN in conf:
+            sens = await sensor.new_sensor(conf[CONF_FLASH_WRITTEN])
+            cg.add(var.set_flash_written_sensor(sens))
+        for trigger_conf in conf.get(CONF_ON_BATCH, []):
+            trigger = cg.new_Pvariable(trigger_conf[CONF_TRIGGER_ID], var)
+            await automation.build_automation(
+                trigger,
+                [
+                    (cg.std_string, "records"),
+                    (cg.uint32, "first_seq"),
+                    (cg.int_, "count"),
+                ],
+                trigger_conf,
+            )
+
+    if CONF_HOT_SET in config:
+        conf = config[CONF_HOT_SET]
+        cg.add(var.set_hot_set(conf[CONF_SIZE], conf[CONF_COMPACTION_INTERVAL]))
+
+    if CONF_IGNORE_TOUCH_RING in config:
+        sw = await cg.get_variable(config[CONF_IGNORE_TOUCH_RING])
+        cg.add(var.set_ignore_touch_ring_switch(sw))
+
+    if CONF_STAGE_TIMING in config:
+        conf = config[CONF_STAGE_TIMING]
+        cg.add(var.set_stage_timing_interval(conf[CONF_UPDATE_INTERVAL]))
+        for stage_index, stage in enumerate(STAGES):
+            for stat_index, statistic in enumerate(STAGE_STATISTICS):
+                if statistic in conf.get(stage, {}):
+                    sens = await sensor.new_sensor(conf[stage][statistic])
+                    cg.add(var.set_stage_sensor(stage_index, stat_index, sens))
+
+    for event_index, event in enumerate(LED_EVENTS):
+        if event in config.get(CONF_LED_PROFILES, {}):
+            conf = config[CONF_LED_PROFILES][event]
+            cg.add(
+                var.set_led_profile(
+                    event_index,
+                    conf[CONF_MODE],
+                    conf[CONF_SPEED],
+                    conf[CONF_COLOR],
+                    conf[CONF_COUNT],
+                )
+            )
+
+    if CONF_EMULATOR in config:
+        conf = config[CONF_EMULATOR]
+        emu = cg.new_Pvariable(conf[CONF_ID], conf.get(CONF_CAPACITY, capacity))
+        cg.add(emu.set_error_rate(conf[CONF_ERROR_RATE]))
+        cg.add(emu.set_bad_image_rate(conf[CONF_BAD_IMAGE_RATE]))
+        cg.add(emu.set_false_reject_rate(conf[CONF_FALSE_REJECT_RATE]))
+        cg.add(emu.set_seed(conf[CONF_SEED]))
+        for slot, token in conf[CONF_TEMPLATES].items():
+            cg.add(emu.store_template(slot, token))
+        if CONF_GET_IMAGE_TIME in conf:
+            cg.add(emu.set_get_image_time(conf[CONF_GET_IMAGE_TIME]))
+        if CONF_IMAGE2TZ_TIME in conf:
+            cg.add(emu.set_image2tz_time(conf[CONF_IMAGE2TZ_TIME]))
+        if CONF_SEARCH_TIME in conf:
+            cg.add(emu.set_search_time(conf[CONF_SEARCH_TIME]))
+        if CONF_STORE_TIME in conf:
+            cg.add(emu.set_store_time(conf[CONF_STORE_TIME]))
+        cg.add(var.set_emulator(emu))
+
+    for conf in config.get(CONF_ON_BACKUP_CHUNK, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger,
+            [
+                (cg.std_string, "kind"),
+                (cg.int_, "id"),
+                (cg.int_, "index"),
+                (cg.std_string, "data"),
+                (cg.uint32, "checksum"),
+            ],
+            conf,
+        )
+
+    for conf in config.get(CONF_ON_RESTORE_PROGRESS, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(
+            trigger, [(cg.int_, "id"), (cg.bool_, "written")], conf
+        )
+
     # Library is added in YAML, not here
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include "esphome/core/log.h"
+#include "sensor_hal.h"
+#ifdef USE_TIME
+#include "esphome/core/time.h"
+#endif
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+enum class AccessResult : uint8_t {
+  MATCH,
+  RING,
+  BLOCKED,
+};
+
+/**
+ * Every access decision, kept on the device until Home Assistant has it.
+ *
+ * Records go to a page staged in RAM and the page goes to flash when it is
+ * full, on the flush interval, or at shutdown, never per decision. Pages
+ * rotate over a fixed ring of keys, so each key is rewritten only once per
+ * trip round the ring and the oldest page is the one that gets overwritten.
+ * Sequence numbers run on across reboots; seq / PAGE_RECORDS picks a page
+ * and its key.
+ *
+ * Page layout (little endian):
+ *   magic u32 | version u8 | count u8 | reserved u16 | first_seq u32
+ *   count x (time u32, id u16, confidence u16, result u8)
+ *   checksum u32 (FNV-1a over everything before it)
+ * time is Unix time, 0 if the clock was not set; id 0xFFFF means none.
+ *
+ * An upload hands the records since the last one to the batch callback,
+ * one batch of up to BATCH_RECORDS per call of upload_next(), as JSON:
+ *   [{"seq":12,"result":"match","id":3,"confidence":182,"time":"2026-10-16T09:01:31+0200"},...]
+ * Handing a batch over proves nothing: events sent before Home Assistant
+ * subscribes, or to a client that isn't Home Assistant, are dropped. So the
+ * cursor only moves, and goes to flash, when Home Assistant acknowledges the
+ * records before a sequence number; until then the next upload sends them
+ * again. Records carry their seq, so repeats are easy to recognize.
+ */
+class AccessLog {
+ public:
+  using BatchCallback = std::function<void(const std::string &records, uint32_t first_seq, int count)>;
+
+  static constexpr uint32_t MAGIC = 0x31474C41;  // "ALG1"
+  static constexpr uint8_t VERSION = 1;
+  static constexpr size_t HEADER_SIZE = 12;
+  static constexpr size_t RECORD_SIZE = 9;
+  static constexpr size_t CHECKSUM_SIZE = 4;
+  static constexpr uint8_t PAGE_RECORDS = 32;
+  static constexpr size_t PAGE_SIZE = HEADER_SIZE + PAGE_RECORDS * RECORD_SIZE + CHECKSUM_SIZE;
+  static constexpr uint8_t BATCH_RECORDS = 16;
+  // About 6 kB of NVS, a third of ESPHome's default 20 kB partition
+  static constexpr uint8_t MAX_PAGES = 16;
+
+  void set_store(KeyValueStore *store) { store_ = store; }
+  void set_pages(uint8_t pages) { pages_ = std::min(pages, MAX_PAGES); }
+  void set_batch_callback(BatchCallback &&callback) { callback_ = std::move(callback); }
+
+  bool enabled() const { return pages_ > 0; }
+
+  // Find the newest page and carry on from it
+  void load() {
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint8_t index = 0; index < pages_; index++) {
+      uint32_t first_seq;
+      uint8_t count;
+      if (read_page(index, page_, &first_seq, &count) && (!found || int32_t(first_seq - newest) > 0)) {
+        found = true;
+        newest = first_seq;
+      }
+    }
+    if (found) {
+      uint8_t count;
+      read_page(page_index(newest), staged_, &staged_first_, &count);
+      staged_count_ = count;
+      if (staged_count_ == PAGE_RECORDS) {
+        start_page(staged_first_ + PAGE_RECORDS);
+      }
+    } else {
+      start_page(0);
+    }
+    cached_first_ = NO_PAGE;
+
+    uint8_t saved[4];
+    uploaded_ = store_->get_bytes(CURSOR_KEY, saved, sizeof(saved)) == sizeof(saved) ? get_le32(saved) : 0;
+    ESP_LOGD(TAG, "Access log holds %u records, %u not uploaded", (unsigned) (next_seq() - oldest_seq()),
+             (unsigned) (next_seq() - upload_start()));
+  }
+
+  void append(AccessResult result, int id, int confidence, uint32_t time) {
+    uint8_t *record = staged_ + HEADER_SIZE + staged_count_ * RECORD_SIZE;
+    put_le32(record, time);
+    put_le16(record + 4, id < 0 ? NO_ID : id);
+    put_le16(record + 6, confidence);
+    record[8] = uint8_t(result);
+    staged_count_++;
+    dirty_ = true;
+    if (staged_count_ == PAGE_RECORDS) {
+      flush();
+      start_page(staged_first_ + PAGE_RECORDS);
+    }
+  }
+
+  // Write the staged page if it has records flash doesn't have yet
+  bool flush() {
+    if (!dirty_) {
+      return true;
+    }
+    size_t size = seal(staged_, staged_first_, staged_count_);
+    char key[8];
+    if (!store_->put_bytes(page_key(page_index(staged_first_), key), staged_, size)) {
+      ESP_LOGE(TAG, "Writing access log page %s failed", key);
+      return false;
+    }
+    bytes_written_ += size;
+    dirty_ = false;
+    return true;
+  }
+
+  uint32_t next_seq() const { return staged_first_ + staged_count_; }
+  // Older records have been overwritten
+  uint32_t oldest_seq() const {
+    uint32_t span = uint32_t(pages_ - 1) * PAGE_RECORDS;
+    return staged_first_ > span ? staged_first_ - span : 0;
+  }
+
+  // Upload side
+
+  // From where the last upload stopped, or everything still held
+  void start_upload(bool all) {
+    if (!all && int32_t(uploaded_ - oldest_seq()) < 0) {
+      ESP_LOGW(TAG, "%u access log records were overwritten before their upload",
+               (unsigned) (oldest_seq() - uploaded_));
+    }
+    upload_seq_ = all ? oldest_seq() : upload_start();
+    uploading_ = upload_seq_ != next_seq();
+  }
+  bool uploading() const { return uploading_; }
+
+  // Hand out one batch. Returns false once the upload is done.
+  bool upload_next() {
+    if (!uploading_) {
+      return false;
+    }
+    if (int32_t(upload_seq_ - oldest_seq()) < 0) {
+      ESP_LOGW(TAG, "%u access log records were overwritten before their upload",
+               (unsigned) (oldest_seq() - upload_seq_));
+      upload_seq_ = oldest_seq();
+    }
+    uint32_t first = upload_seq_ - upload_seq_ % PAGE_RECORDS;
+    const uint8_t *page = page_of(first);
+    uint32_t end = first + PAGE_RECORDS;
+    if (end > next_seq()) {
+      end = next_seq();
+    }
+    if (page == nullptr) {
+      ESP_LOGW(TAG, "Access log page of records %u..%u is unreadable, skipped", (unsigned) first, (unsigned) end - 1);
+      upload_seq_ = end;
+    } else {
+      if (end > upload_seq_ + BATCH_RECORDS) {
+        end = upload_seq_ + BATCH_RECORDS;
+      }
+      uint32_t batch_first = upload_seq_;
+      batch_.assign("[");
+      for (; upload_seq_ < end; upload_seq_++) {
+        append_json(upload_seq_, page + HEADER_SIZE + (upload_seq_ - first) * RECORD_SIZE);
+      }
+      batch_.append("]");
+      if (callback_) {
+        callback_(batch_, batch_first, end - batch_first);
+      }
+    }
+    if (upload_seq_ == next_seq()) {
+      finish_upload();
+    }
+    return uploading_;
+  }
+
+  // Home Assistant has every record before seq. Returns false for a seq the log never handed out.
+  bool acknowledge(uint32_t seq) {
+    if (int32_t(seq - next_seq()) > 0) {
+      ESP_LOGW(TAG, "Ignoring acknowledge up to record %u, the log ends at %u", (unsigned) seq,
+               (unsigned) next_seq());
+      return false;
+    }
+    if (int32_t(seq - uploaded_) <= 0) {
+      return true;
+    }
+    uploaded_ = seq;
+    uint8_t saved[4];
+    put_le32(saved, uploaded_);
+    if (store_->put_bytes(CURSOR_KEY, saved, sizeof(saved))) {
+      bytes_written_ += sizeof(saved);
+    }
+    return true;
+  }
+
+  // Flash bytes written since the last reset
+  uint32_t bytes_written() const { return bytes_written_; }
+  void reset_bytes_written() { bytes_written_ = 0; }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_sensor.access_log";
+  static constexpr const char *CURSOR_KEY = "alog_sent";
+  static constexpr uint16_t NO_ID = 0xFFFF;
+  static constexpr uint32_t NO_PAGE = 0xFFFFFFFF;
+
+  uint8_t page_index(uint32_t first_seq) const { return (first_seq / PAGE_RECORDS) % pages_; }
+
+  static const char *page_key(uint8_t index, char *key) {
+    snprintf(key, 8, "alog%u", index);
+    return key;
+  }
+
+  void start_page(uint32_t first_seq) {
+    staged_first_ = first_seq;
+    staged_count_ = 0;
+    dirty_ = false;
+  }
+
+  uint32_t upload_start() const {
+    // A cursor ahead of the log means the log was wiped under it
+    if (int32_t(uploaded_ - oldest_seq()) < 0 || int32_t(uploaded_ - next_seq()) > 0) {
+      return oldest_seq();
+    }
+    return uploaded_;
+  }
+
+  // The cursor stays until acknowledge()
+  void finish_upload() { uploading_ = false; }
+
+  static size_t seal(uint8_t *page, uint32_t first_seq, uint8_t count) {
+    put_le32(page, MAGIC);
+    page[4] = VERSION;
+    page[5] = count;
+    put_le16(page + 6, 0);
+    put_le32(page + 8, first_seq);
+    size_t length = HEADER_SIZE + count * RECORD_SIZE;
+    put_le32(page + length, blob_checksum(page, length));
+    return length + CHECKSUM_SIZE;
+  }
+
+  bool read_page(uint8_t index, uint8_t *page, uint32_t *first_seq, uint8_t *count) {
+    char key[8];
+    size_t length = store_->get_bytes(page_key(index, key), page, PAGE_SIZE);
+    if (length < HEADER_SIZE + CHECKSUM_SIZE || get_le32(page) != MAGIC || page[4] != VERSION ||
+        page[5] > PAGE_RECORDS || length != HEADER_SIZE + page[5] * RECORD_SIZE + CHECKSUM_SIZE ||
+        get_le32(page + length - CHECKSUM_SIZE) != blob_checksum(page, length - CHECKSUM_SIZE)) {
+      return false;
+    }
+    *first_seq = get_le32(page + 8);
+    *count = page[5];
+    return *first_seq % PAGE_RECORDS == 0 && page_index(*first_seq) == index;
+  }
+
+  // The page holding records from first on, from RAM or flash. nullptr if it is lost.
+  const uint8_t *page_of(uint32_t first) {
+    if (first == staged_first_) {
+      return staged_;
+    }
+    if (cached_first_ != first) {
+      uint32_t first_seq;
+      uint8_t count;
+      if (!read_page(page_index(first), page_, &first_seq, &count) || first_seq != first ||
+          count != PAGE_RECORDS) {
+        return nullptr;
+      }
+      cached_first_ = first;
+    }
+    return page_;
+  }
+
+  void append_json(uint32_t seq, const uint8_t *record) {
+    static const char *const RESULTS[] = {"match", "ring", "blocked"};
+    uint8_t result = record[8];
+    char number[96];
+    snprintf(number, sizeof(number), "%s{\"seq\":%u,\"result\":\"%s\"", batch_.size() > 1 ? "," : "",
+             (unsigned) seq, result < 3 ? RESULTS[result] : "unknown");
+    batch_.append(number);
+    uint16_t id = get_le16(record + 4);
+    if (id != NO_ID) {
+      snprintf(number, sizeof(number), ",\"id\":%u,\"confidence\":%u", id, get_le16(record + 6));
+      batch_.append(number);
+    }
+#ifdef USE_TIME
+    uint32_t time = get_le32(record);
+    if (time != 0) {
+      batch_.append(",\"time\":\"")
+          .append(ESPTime::from_epoch_local(time).strftime("%Y-%m-%dT%H:%M:%S%z"))
+          .append("\"");
+    }
+#endif
+    batch_.append("}");
+  }
+
+  KeyValueStore *store_{nullptr};
+  uint8_t pages_ = 0;
+  BatchCallback callback_;
+
+  uint8_t staged_[PAGE_SIZE];
+  uint32_t staged_first_ = 0;
+  uint8_t staged_count_ = 0;
+  bool dirty_ = false;
+  // Flash page last read for an upload
+  uint8_t page_[PAGE_SIZE];
+  uint32_t cached_first_ = NO_PAGE;
+
+  // Everything before it has been acknowledged
+  uint32_t uploaded_ = 0;
+  uint32_t upload_seq_ = 0;
+  bool uploading_ = false;
+  std::string batch_;
+  uint32_t bytes_written_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include "esphome/core/automation.h"
+#include "fingerprint_sensor.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+// Fires for every record of a library backup, see LibraryBackup
+class BackupChunkTrigger : public Trigger<std::string, int, int, std::string, uint32_t> {
+ public:
+  explicit BackupChunkTrigger(FingerprintSensor *parent) {
+    parent->add_on_backup_chunk_callback(
+        [this](const std::string &kind, int id, int index, const std::string &data, uint32_t checksum) {
+          this->trigger(kind, id, index, data, checksum);
+        });
+  }
+};
+
+// Fires once each restored template is on the sensor, with its ID and whether the slot was written
+class RestoreProgressTrigger : public Trigger<int, bool> {
+ public:
+  explicit RestoreProgressTrigger(FingerprintSensor *parent) {
+    parent->add_on_restore_progress_callback([this](int id, bool written) { this->trigger(id, written); });
+  }
+};
+
+// Fires for every batch of an access log upload, see AccessLog
+class AccessLogBatchTrigger : public Trigger<std::string, uint32_t, int> {
+ public:
+  explicit AccessLogBatchTrigger(FingerprintSensor *parent) {
+    parent->add_on_access_log_batch_callback(
+        [this](const std::string &records, uint32_t first_seq, int count) {
+          this->trigger(records, first_seq, count);
+        });
+  }
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -1,16 +1,51 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/components/uart/uart.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
-#include <Adafruit_Fingerprint.h>
-#include <Preferences.h>
+#ifdef USE_SWITCH
+#include "esphome/components/switch/switch.h"
+#endif
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#endif
+#include "access_log.h"
+#include "hot_set.h"
+#include "led_manager.h"
+#include "library_backup.h"
+#include "match_event.h"
+#include "name_store.h"
+#include "occupancy_map.h"
+#include "platform_hal.h"
+#include "power_save.h"
+#include "sensor_bus.h"
+#include "sensor_emulator.h"
+#include "sensor_link.h"
+#include "sensor_profile.h"
+#include "sensor_protocol.h"
+#include "sensor_scheduler.h"
+#include "spsc_ring.h"
+#include "stage_timing.h"
 
 namespace esphome {
 namespace fingerprint_sensor {
 
+// Outcome of one scan, reported to scan result listeners
+enum class ScanResult : uint8_t {
+  MATCH,      // Known finger
+  NO_MATCH,   // Unknown finger, doorbell rings
+  BAD_IMAGE,  // Image could not be converted into a template
+  BLOCKED,    // Known finger, but matches are blocked, see set_matches_blocked()
+};
+
 class FingerprintSensor : public Component, public uart::UARTDevice {
  public:
   FingerprintSensor() = default;
@@ -21,74 +56,322 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
   void set_enrolled_count_sensor(sensor::Sensor *sensor) { enrolled_count_sensor_ = sensor; }
   void set_status_sensor(text_sensor::TextSensor *sensor) { status_sensor_ = sensor; }
   void set_ring_sensor(binary_sensor::BinarySensor *sensor) { ring_sensor_ = sensor; }
+  void set_loop_time_sensor(sensor::Sensor *sensor) { loop_time_sensor_ = sensor; }
+  void set_match_event_sensor(text_sensor::TextSensor *sensor) { match_event_.set_sensor(sensor); }
+  void set_match_event_window(uint32_t window_ms) { match_event_.set_window(window_ms); }
+#ifdef USE_TIME
+  void set_time(time::RealTimeClock *time) { match_event_.set_time(time); }
+#endif
+  // Sensor model, one of the profiles in sensor_profile.h. R503 unless set.
+  template<typename P> void set_model() {
+    profile_ = SensorProfile::of<P>();
+    link_baud_rate_ = P::BAUD_RATE;
+  }
+  void set_led_profile(uint8_t event, uint8_t mode, uint8_t speed, uint8_t color, uint8_t count) {
+    led_.set_profile(LedEvent(event), LedProfile{mode, speed, color, count});
+  }
+  void set_queue_depth_sensor(sensor::Sensor *sensor) { queue_depth_sensor_ = sensor; }
+  void set_uart_errors_sensor(sensor::Sensor *sensor) { uart_errors_sensor_ = sensor; }
+  void set_heap_free_sensor(sensor::Sensor *sensor) { heap_free_sensor_ = sensor; }
+  void set_heap_max_block_sensor(sensor::Sensor *sensor) { heap_max_block_sensor_ = sensor; }
+  void set_link_rate_sensor(sensor::Sensor *sensor) { link_rate_sensor_ = sensor; }
+  void set_round_trip_sensor(sensor::Sensor *sensor) { round_trip_sensor_ = sensor; }
+  // Move the link to this rate once connected, if it proves reliable there
+  void set_max_baud_rate(uint32_t baud_rate) { max_baud_rate_ = baud_rate; }
+  void set_match_cooldown(uint32_t cooldown_ms) { match_cooldown_ms_ = cooldown_ms; }
+  void set_ring_cooldown(uint32_t cooldown_ms) { ring_cooldown_ms_ = cooldown_ms; }
+  // Up to attempts images per touch while the finger stays down, within time_ms of the first
+  void set_burst(uint8_t attempts, uint32_t time_ms) {
+    burst_attempts_ = attempts;
+    burst_time_ms_ = time_ms;
+  }
+  void set_burst_retries_sensor(sensor::Sensor *sensor) { burst_retries_sensor_ = sensor; }
+  void set_burst_rescued_sensor(sensor::Sensor *sensor) { burst_rescued_sensor_ = sensor; }
+  void set_enroll_progress_sensor(sensor::Sensor *sensor) { enroll_progress_sensor_ = sensor; }
+  void set_enroll_timeout(uint32_t timeout_ms) { enroll_timeout_ms_ = timeout_ms; }
+  void set_touch_pin(InternalGPIOPin *pin) { touch_pin_ = pin; }
+  // Search the most used templates first and move them into the lowest slots
+  void set_hot_set(uint16_t size, uint32_t compaction_interval_ms) {
+    hot_set_size_ = size;
+    compaction_interval_ms_ = compaction_interval_ms;
+  }
+  // Light sleep while idle, woken by the touch ring (ESP32 only)
+  void set_power_save(uint32_t idle_after_ms, uint32_t max_sleep_ms) {
+    power_save_.configure(idle_after_ms, max_sleep_ms);
+  }
+  void set_power_save_interval(uint32_t interval_ms) { power_save_interval_ms_ = interval_ms; }
+  void set_awake_sensor(sensor::Sensor *sensor) { awake_sensor_ = sensor; }
+  void set_wakeups_sensor(sensor::Sensor *sensor) { wakeups_sensor_ = sensor; }
+  void set_wake_latency_sensor(sensor::Sensor *sensor) { wake_latency_sensor_ = sensor; }
+  // Keep every decision in flash until it has been uploaded, see AccessLog
+  void set_access_log(uint8_t pages, uint32_t flush_interval_ms) {
+    access_log_.set_pages(pages);
+    access_log_flush_ms_ = flush_interval_ms;
+  }
+  void set_access_log_interval(uint32_t interval_ms) { access_log_interval_ms_ = interval_ms; }
+  void set_flash_written_sensor(sensor::Sensor *sensor) { flash_written_sensor_ = sensor; }
+  // Scan from a pinned FreeRTOS task instead of loop() (ESP32 only)
+  void set_sensor_task(uint8_t core, uint8_t priority) {
+    task_enabled_ = true;
+    task_core_ = core;
+    task_priority_ = priority;
+  }
+  // Readers of the same ESP that take turns on the main loop
+  void set_scheduler(SensorScheduler *scheduler) { scheduler_ = scheduler; }
+  // NVS namespace of the names, hot set and link rate; one per reader
+  void set_storage_namespace(const char *name) { storage_namespace_ = name; }
+  const char *get_storage_namespace() const { return storage_namespace_; }
+  // Hardware abstraction. Anything not set falls back to the platform default in setup().
+  void set_transport(SensorTransport *transport) { transport_ = transport; }
+  void set_clock(Clock *clock) { clock_ = clock; }
+  void set_store(KeyValueStore *store) { store_ = store; }
+  void set_emulator(SensorEmulator *emulator) {
+    emulator_ = emulator;
+    transport_ = emulator;
+  }
+  SensorEmulator *get_emulator() { return emulator_; }
+  SensorProtocol &get_protocol() { return finger_; }
+  const LedManager &get_led_manager() const { return led_; }
+  // Shared access to the sensor for other components
+  SensorBus *get_bus() { return &bus_; }
+  const HotSet &get_hot_set() const { return hot_set_; }
+  bool is_connected() const { return connected_; }
+  const SensorLink &get_link() const { return link_; }
+  
+  // Matches are turned away while set, e.g. by fingerprint_pairing until the
+  // attached sensor is confirmed as the paired one. Cached, so the match path never
+  // waits for a check of its own.
+  void set_matches_blocked(bool blocked) { matches_blocked_ = blocked; }
+  // Also while the slot map is lost, see load_slot_map()
+  bool matches_blocked() const { return matches_blocked_ || slot_map_lost_; }
+  
+  // Called each time the sensor answers again, the first connection included
+  void add_on_connected_callback(std::function<void()> &&callback) { connected_callback_.add(std::move(callback)); }
+  
+  // Called with the result, finger ID and confidence of every scan decision
+  void add_on_scan_result_callback(std::function<void(ScanResult, int, int)> &&callback) {
+    scan_result_callback_.add(std::move(callback));
+  }
+  // Called with every record of a library backup, see LibraryBackup
+  void add_on_backup_chunk_callback(
+      std::function<void(const std::string &, int, int, const std::string &, uint32_t)> &&callback) {
+    backup_chunk_callback_.add(std::move(callback));
+  }
+  // Called once each restored template is on the sensor: ID, and whether the slot had to be written
+  void add_on_restore_progress_callback(std::function<void(int, bool)> &&callback) {
+    restore_progress_callback_.add(std::move(callback));
+  }
+  // Called with each batch of an access log upload: JSON records, first seq and count
+  void add_on_access_log_batch_callback(std::function<void(const std::string &, uint32_t, int)> &&callback) {
+    access_log_batch_callback_.add(std::move(callback));
+  }
+  // State of other components that should travel with a library backup
+  void add_backup_section(const char *kind, std::function<std::string()> &&save,
+                          std::function<void(const std::string &)> &&restore) {
+    backup_.add_section(kind, std::move(save), std::move(restore));
+  }
+  void set_stage_sensor(uint8_t stage, uint8_t statistic, sensor::Sensor *sensor) {
+    stage_sensors_[stage][statistic] = sensor;
+  }
+  void set_stage_timing_interval(uint32_t interval_ms) { stage_timing_interval_ms_ = interval_ms; }
+  const StageTimings &get_stage_timings() const { return stage_timings_; }
+#ifdef USE_SWITCH
+  void set_ignore_touch_ring_switch(switch_::Switch *sw) { ignore_touch_ring_switch_ = sw; }
+#endif
   
   void setup() override {
+    if (clock_ == nullptr) {
+      clock_ = &system_clock_;
+    }
+    if (transport_ == nullptr && this->parent_ != nullptr) {
+      uart_transport_.set_parent(this->parent_);
+      transport_ = &uart_transport_;
+    }
+#ifdef USE_ARDUINO
+    if (store_ == nullptr) {
+      preferences_store_.set_name(storage_namespace_);
+      store_ = &preferences_store_;
+    }
+#endif
+    if (store_ == nullptr) {
+      store_ = &memory_store_;
+    }
+    if (transport_ == nullptr) {
+      ESP_LOGE(TAG, "No transport to the fingerprint sensor");
+      this->mark_failed();
+      return;
+    }
+    if (emulator_ != nullptr) {
+      ESP_LOGW(TAG, "Using the sensor emulator, no real sensor is attached");
+      emulator_->set_clock(clock_);
+    }
+    if (scheduler_ == nullptr) {
+      scheduler_ = &own_scheduler_;
+    }
+    member_ = scheduler_->join();
+    
     // Initialize preferences for storing fingerprint names
-    preferences_.begin("fingerprints", false);
+    store_->begin();
+    name_store_.set_store(store_);
+    hot_set_.set_store(store_);
+    // Rate a previous negotiation moved the sensor to
+    uint8_t saved[4];
+    if (store_->get_bytes(BAUD_RATE_KEY, saved, sizeof(saved)) == sizeof(saved)) {
+      saved_baud_rate_ = get_le32(saved);
+    }
+    baud_switchable_ = transport_->set_baud_rate(profile_.baud_rate);
+    backup_.set_chunk_callback([this](const std::string &kind, int id, int index, const std::string &data,
+                                      uint32_t checksum) { backup_chunk_callback_.call(kind, id, index, data, checksum); });
+    
+    // Wake on the touch ring instead of polling, if it is wired up
+    if (touch_pin_ != nullptr) {
+      touch_pin_->setup();
+      touch_pin_->attach_interrupt(&FingerprintSensor::touch_isr, this, gpio::INTERRUPT_RISING_EDGE);
+    }
     
     // Initialize the fingerprint sensor
-    finger_.begin(57600);
+    finger_.set_transport(transport_);
+    finger_.set_clock(clock_);
+    finger_.set_capacity(profile_.capacity);
+    led_.set_protocol(&finger_);
+    led_.set_enabled(profile_.aura_led);
+    bus_.set_protocol(&finger_);
     
-    // Try to connect to sensor
-    delay(50);
-    if (finger_.verifyPassword()) {
-      ESP_LOGI(TAG, "Fingerprint sensor found!");
-      finger_.LEDcontrol(FINGERPRINT_LED_FLASHING, 25, FINGERPRINT_LED_BLUE, 0);
-      
-      // Get sensor parameters
-      finger_.getParameters();
-      ESP_LOGI(TAG, "Capacity: %d", finger_.capacity);
-      ESP_LOGI(TAG, "Security level: %d", finger_.security_level);
-      
-      // Get template count
-      finger_.getTemplateCount();
-      ESP_LOGI(TAG, "Sensor contains %d templates", finger_.templateCount);
-      
-      if (enrolled_count_sensor_ != nullptr) {
-        enrolled_count_sensor_->publish_state(finger_.templateCount);
-      }
-      if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Ready");
+    // The sensor is looked for from loop(), so a missing or slow one doesn't hold up boot
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state("Connecting...");
+    }
+    
+    // Rolling per-stage latency, one window per interval
+    if (has_stage_sensors()) {
+      this->set_interval("stage_timing", stage_timing_interval_ms_, [this]() { publish_stage_timings(); });
+    }
+    
+    // Report the slowest loop() pass of each window, then start a new window
+    if (loop_time_sensor_ != nullptr) {
+      this->set_interval("loop_time", LOOP_TIME_WINDOW_MS, [this]() {
+        loop_time_sensor_->publish_state(loop_time_max_us_ / 1000.0f);
+        loop_time_max_us_ = 0;
+      });
+    }
+    
+    if (queue_depth_sensor_ != nullptr || uart_errors_sensor_ != nullptr) {
+      this->set_interval("bus", BUS_STATS_INTERVAL_MS, [this]() { publish_bus_stats(); });
+    }
+    
+    if (heap_free_sensor_ != nullptr || heap_max_block_sensor_ != nullptr) {
+      this->set_interval("heap", HEAP_INTERVAL_MS, [this]() { publish_heap(); });
+    }
+    
+    if (hot_set_.enabled()) {
+      this->set_interval("hot_set", compaction_interval_ms_, [this]() { compact_hot_set(); });
+    }
+    
+    if (access_log_.enabled()) {
+      access_log_.set_store(store_);
+      access_log_.load();
+      access_log_.set_batch_callback([this](const std::string &records, uint32_t first_seq, int count) {
+        access_log_batch_callback_.call(records, first_seq, count);
+      });
+      this->set_interval("access_log_flush", access_log_flush_ms_, [this]() { access_log_.flush(); });
+      if (flash_written_sensor_ != nullptr) {
+        flash_day_start_ = clock_->millis();
+        this->set_interval("access_log", access_log_interval_ms_, [this]() { publish_flash_written(); });
       }
-      connected_ = true;
-      
-      // Load fingerprint names from preferences
-      load_fingerprint_names();
-      
-      // Set LED to ready state
-      finger_.LEDcontrol(FINGERPRINT_LED_BREATHING, 250, FINGERPRINT_LED_BLUE);
-    } else {
-      ESP_LOGE(TAG, "Fingerprint sensor not found!");
-      delay(5000);
-      // Try again
-      if (finger_.verifyPassword()) {
-        ESP_LOGI(TAG, "Fingerprint sensor found on second try!");
-        connected_ = true;
-        finger_.LEDcontrol(FINGERPRINT_LED_BREATHING, 250, FINGERPRINT_LED_BLUE);
+    }
+    
+    if (power_save_.enabled()) {
+      if (touch_pin_ == nullptr) {
+        ESP_LOGE(TAG, "Power save needs the touch ring to wake up, staying awake");
+      } else if (!power_save_.begin()) {
+        ESP_LOGE(TAG, "Automatic light sleep could not be enabled, staying awake");
       } else {
-        if (status_sensor_ != nullptr) {
-          status_sensor_->publish_state("Sensor not found!");
-        }
-        connected_ = false;
-        return;
+        power_save_.reset_window(clock_->micros());
+        this->set_interval("power_save", power_save_interval_ms_, [this]() { publish_power_save(); });
       }
     }
+    
+#ifdef USE_ESP32
+    if (task_enabled_) {
+      start_sensor_task();
+    }
+#endif
   }
   
   void loop() override {
-    if (!connected_) return;
-    
-    // Check if currently enrolling
-    if (enrolling_) {
-      // Enrollment is handled by the service call
+    uint32_t start = clock_->micros();
+    if (!connected_) {
+      if (scheduler_->take_turn(member_, link_.probe_due(clock_->millis()))) {
+        try_connect();
+        scheduler_->done(member_);
+      }
+    } else if (task_running()) {
+      // The sensor task scans. Publish what it found and use the gaps
+      // between its scans for everything else.
+      ScanEvent event;
+      while (events_.pop(&event)) {
+        handle_scan_event(event);
+      }
+      if (events_.dropped() != events_dropped_reported_) {
+        events_dropped_reported_ = events_.dropped();
+        ESP_LOGW(TAG, "Scan event queue overflowed, %u events lost", events_dropped_reported_);
+      }
+      if (!scan_in_progress() && sensor_lock_.try_lock()) {
+        sensor_pass(false);
+        sensor_lock_.unlock();
+      }
+    } else {
+      sensor_pass(true);
+    }
+    if (connected_ && finger_.silent_commands() >= SensorLink::LOST_AFTER) {
+      connection_lost();
+    }
+    match_event_.loop(clock_->millis());
+    // One batch per pass, so a long backlog doesn't hold up the loop
+    if (access_log_.uploading()) {
+      access_log_.upload_next();
+    }
+    uint32_t elapsed = clock_->micros() - start;
+    if (elapsed > loop_time_max_us_) {
+      loop_time_max_us_ = elapsed;
+    }
+    if (power_save_.enabled() && touch_pin_ != nullptr) {
+      manage_power();
+    }
+  }
+  
+  // Staged access log records would be lost with the RAM
+  void on_shutdown() override {
+    if (access_log_.enabled()) {
+      access_log_.flush();
+    }
+  }
+  
+  // Service: Send the access log records Home Assistant hasn't acknowledged
+  // yet, or all that are still held, as access log batches. Runs in the background.
+  void upload_access_log(bool all) {
+    if (!access_log_.enabled()) {
+      ESP_LOGE(TAG, "The access log is not enabled");
       return;
     }
-    
-    // Normal scanning mode
-    scan_fingerprint();
+    if (access_log_.uploading()) {
+      ESP_LOGW(TAG, "Access log upload already running");
+      return;
+    }
+    access_log_.start_upload(all);
+  }
+  
+  // Service: Home Assistant has stored every access log record before seq,
+  // i.e. first_seq + count of the last batch it got
+  void ack_access_log(uint32_t seq) {
+    if (!access_log_.enabled()) {
+      ESP_LOGE(TAG, "The access log is not enabled");
+      return;
+    }
+    access_log_.acknowledge(seq);
   }
   
-  // Service: Enroll fingerprint
+  // Service: Enroll fingerprint. Returns immediately, loop() drives the passes.
   void enroll_fingerprint(int id, const std::string &name) {
     if (!connected_) {
       ESP_LOGE(TAG, "Sensor not connected!");
@@ -98,55 +381,81 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
       return;
     }
     
-    if (id < 1 || id > 200) {
-      ESP_LOGE(TAG, "Invalid ID: %d (must be 1-200)", id);
+    if (!check_slot_map("enroll")) {
+      return;
+    }
+    
+    if (id < 1 || id >= finger_.capacity()) {
+      ESP_LOGE(TAG, "Invalid ID: %d (must be 1-%d)", id, finger_.capacity() - 1);
       if (status_sensor_ != nullptr) {
         status_sensor_->publish_state("Error: Invalid ID");
       }
       return;
     }
     
-    enrolling_ = true;
-    enroll_id_ = id;
-    enroll_name_ = name;
+    if (enroll_.phase != EnrollPhase::IDLE) {
+      ESP_LOGE(TAG, "Enrollment for ID %d already running", enroll_.id);
+      if (status_sensor_ != nullptr) {
+        status_sensor_->publish_state("Error: Enrollment already running");
+      }
+      return;
+    }
+    // Exports and restores move templates through char buffer 2, where a pass keeps its image
+    if (backup_running_ || backup_.importing()) {
+      ESP_LOGE(TAG, "Cannot enroll while a backup or restore is running");
+      if (status_sensor_ != nullptr) {
+        status_sensor_->publish_state("Error: Backup running");
+      }
+      return;
+    }
+    
+    enroll_.id = id;
+    enroll_.name = name;
     
     ESP_LOGI(TAG, "Starting enrollment for ID %d with name '%s'", id, name.c_str());
     if (status_sensor_ != nullptr) {
-      status_sensor_->publish_state("Enrollment started. Place finger on sensor 5 times...");
+      status_sensor_->publish_state("Enrollment started. Place finger on sensor " +
+                                   std::to_string(profile_.enroll_passes) + " times...");
     }
-    
-    // Perform enrollment
-    int result = perform_enrollment(id);
-    
-    if (result == 0) {
-      // Success
-      ESP_LOGI(TAG, "Enrollment successful!");
-      
-      // Save name to preferences
-      String key = String(id);
-      preferences_.putString(key.c_str(), name.c_str());
-      fingerprint_names_[id] = name;
-      
-      if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Enrollment successful!");
-      }
-      
-      // Update count
-      finger_.getTemplateCount();
-      if (enrolled_count_sensor_ != nullptr) {
-        enrolled_count_sensor_->publish_state(finger_.templateCount);
+    if (enroll_progress_sensor_ != nullptr) {
+      enroll_progress_sensor_->publish_state(0);
+    }
+    enrolling_ = true;
+    start_enroll_pass(1, clock_->millis());
+  }
+  
+  // Service: Enroll into the lowest ID without a template
+  void enroll_next_free(const std::string &name) {
+    uint16_t id = occupancy_.next_free();
+    if (id == OccupancyMap::NONE) {
+      // Without a connected sensor the occupancy is unknown, so no ID is free either
+      if (!connected_) {
+        ESP_LOGE(TAG, "Sensor not connected, no free ID known");
+      } else {
+        ESP_LOGE(TAG, "No free ID left on the sensor");
       }
-    } else {
-      ESP_LOGE(TAG, "Enrollment failed with code: %d", result);
       if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Enrollment failed!");
+        status_sensor_->publish_state(connected_ ? "Error: Sensor full" : "Error: Sensor not connected");
       }
+      return;
     }
-    
-    enrolling_ = false;
-    
-    // Return LED to ready state
-    finger_.LEDcontrol(FINGERPRINT_LED_BREATHING, 250, FINGERPRINT_LED_BLUE);
+    enroll_fingerprint(id, name);
+  }
+  
+  // Lowest ID without a template, or -1 if the sensor is full
+  int next_free_id() const {
+    uint16_t id = occupancy_.next_free();
+    return id == OccupancyMap::NONE ? -1 : id;
+  }
+  
+  // Service: Cancel a running enrollment
+  void cancel_enrollment() {
+    if (enroll_.phase == EnrollPhase::IDLE) {
+      ESP_LOGW(TAG, "No enrollment running");
+      return;
+    }
+    ESP_LOGI(TAG, "Enrollment for ID %d cancelled", enroll_.id);
+    finish_enrollment(false, "Enrollment cancelled");
   }
   
   // Service: Delete fingerprint
@@ -156,31 +465,37 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
       return;
     }
     
-    if (id < 1 || id > 200) {
+    if (!check_slot_map("delete")) {
+      return;
+    }
+    
+    if (id < 1 || id >= finger_.capacity()) {
       ESP_LOGE(TAG, "Invalid ID: %d", id);
       return;
     }
+    if (backup_.importing()) {
+      ESP_LOGE(TAG, "Cannot delete while a restore is running");
+      return;
+    }
     
     ESP_LOGI(TAG, "Deleting fingerprint ID %d", id);
     
-    uint8_t result = finger_.deleteModel(id);
-    if (result == FINGERPRINT_OK) {
+    std::lock_guard<SensorLock> guard(sensor_lock_);
+    uint16_t slot = hot_set_.slot_of(id);
+    uint8_t result = finger_.delete_model(slot);
+    if (result == CONFIRM_OK) {
       ESP_LOGI(TAG, "Fingerprint deleted successfully");
+      hot_set_.forget(slot);
+      occupancy_.clear(id);
       
       // Remove from preferences
-      String key = String(id);
-      preferences_.remove(key.c_str());
       fingerprint_names_.erase(id);
+      name_store_.save(fingerprint_names_);
       
       if (status_sensor_ != nullptr) {
         status_sensor_->publish_state("Fingerprint deleted");
       }
-      
-      // Update count
-      finger_.getTemplateCount();
-      if (enrolled_count_sensor_ != nullptr) {
-        enrolled_count_sensor_->publish_state(finger_.templateCount);
-      }
+      publish_enrolled_count();
     } else {
       ESP_LOGE(TAG, "Delete failed with code: %d", result);
       if (status_sensor_ != nullptr) {
@@ -189,6 +504,127 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
     }
   }
   
+  // Queue one compaction run of the hot set. Also runs every compaction interval.
+  void compact_hot_set() {
+    if (!hot_set_.enabled()) {
+      return;
+    }
+    if (!bus_.submit_job(BUS_PRIORITY_LOW, [this](SensorProtocol &) { run_hot_set_compaction(); })) {
+      ESP_LOGW(TAG, "Sensor command queue is full, skipping hot set compaction");
+    }
+  }
+  
+  // Service: Export names and registered sections through the backup chunk
+  // callback, and with `include_templates` the templates too. Templates are
+  // biometric data, so they only leave the device when asked for by name.
+  // Runs in the background, one template per pass.
+  void backup_library(bool include_templates) {
+    if (!connected_) {
+      ESP_LOGE(TAG, "Sensor not connected!");
+      return;
+    }
+    if (backup_running_) {
+      ESP_LOGW(TAG, "Backup already running");
+      return;
+    }
+    if (!check_slot_map("back up")) {
+      return;
+    }
+    if (enroll_.phase != EnrollPhase::IDLE) {
+      ESP_LOGE(TAG, "Cannot back up while enrolling");
+      return;
+    }
+    
+    uint16_t templates = include_templates ? occupancy_.count() : 0;
+    if (include_templates) {
+      ESP_LOGI(TAG, "Backing up %u templates", templates);
+    } else {
+      ESP_LOGI(TAG, "Backing up names only, without templates");
+    }
+    backup_.emit("begin", finger_.capacity(), templates, "");
+    fingerprint_names_.for_each([this](uint16_t id, const char *name, uint8_t length) {
+      backup_.emit("name", id, 0, std::string(name, length));
+    });
+    backup_.emit_sections();
+    // Past the last ID, so the first job sends just the end record
+    backup_next_id_ = include_templates ? 1 : finger_.capacity();
+    backup_sent_ = 0;
+    backup_running_ = true;
+    continue_backup();
+  }
+  
+  // Service: Take one record of a backup, in the order backup_library() produced them
+  void restore_chunk(const std::string &kind, int id, int index, const std::string &data, uint32_t checksum) {
+    if (!connected_) {
+      ESP_LOGE(TAG, "Sensor not connected!");
+      return;
+    }
+    if (enroll_.phase != EnrollPhase::IDLE) {
+      ESP_LOGE(TAG, "Cannot restore while enrolling");
+      return;
+    }
+    if (!check_slot_map("restore")) {
+      return;
+    }
+    
+    switch (backup_.import_chunk(kind, id, index, data, checksum)) {
+      case LibraryBackup::IMPORT_OK:
+        if (kind == "begin") {
+          ESP_LOGI(TAG, "Restoring %d templates", index);
+          restore_written_ = 0;
+          restore_unchanged_ = 0;
+          // Writes still queued from an aborted restore must not land in this one
+          restore_generation_++;
+          if (status_sensor_ != nullptr) {
+            status_sensor_->publish_state("Restoring fingerprints...");
+          }
+        }
+        return;
+        
+      case LibraryBackup::IMPORT_TEMPLATE_READY: {
+        if (id < 1 || id >= finger_.capacity()) {
+          ESP_LOGW(TAG, "Skipping template for ID %d, beyond the sensor's capacity", id);
+          return;
+        }
+        // Written in the background like an export, the service call returns
+        // right away. Each template is a copy in RAM until then, so only a few
+        // may wait; the sender paces itself on the restore progress callback.
+        if (restore_queued_ >= RESTORE_QUEUE_DEPTH) {
+          ESP_LOGE(TAG, "Restore aborted at ID %d, templates came in faster than they are written", id);
+          finish_restore("Restore failed: sent too fast");
+          return;
+        }
+        std::vector<uint8_t> data = backup_.staged();
+        uint32_t generation = restore_generation_;
+        if (!bus_.submit_job(BUS_PRIORITY_LOW, [this, id, data, generation](SensorProtocol &) {
+              restore_next_template(id, data, generation);
+            })) {
+          ESP_LOGE(TAG, "Restore aborted at ID %d, sensor command queue is full", id);
+          finish_restore("Restore failed!");
+          return;
+        }
+        restore_queued_++;
+        return;
+      }
+      
+      case LibraryBackup::IMPORT_DONE:
+        // Behind the queued template writes
+        if (!bus_.submit_job(BUS_PRIORITY_LOW, [this, generation = restore_generation_](SensorProtocol &) {
+              complete_restore(generation);
+            })) {
+          ESP_LOGE(TAG, "Restore aborted, sensor command queue is full");
+          finish_restore("Restore failed!");
+        }
+        return;
+        
+      case LibraryBackup::IMPORT_FAILED:
+        if (status_sensor_ != nullptr) {
+          status_sensor_->publish_state("Restore failed: " + backup_.import_error());
+        }
+        return;
+    }
+  }
+  
   // Service: Clear all fingerprints
   void clear_all() {
     if (!connected_) {
@@ -196,15 +632,31 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
       return;
     }
     
+    if (backup_.importing()) {
+      ESP_LOGE(TAG, "Cannot clear while a restore is running");
+      return;
+    }
+    
     ESP_LOGI(TAG, "Clearing all fingerprints");
     
-    uint8_t result = finger_.emptyDatabase();
-    if (result == FINGERPRINT_OK) {
+    std::lock_guard<SensorLock> guard(sensor_lock_);
+    uint8_t result = finger_.empty_database();
+    if (result == CONFIRM_OK) {
       ESP_LOGI(TAG, "Database cleared successfully");
       
-      // Clear preferences
-      preferences_.clear();
+      // Names and slot map only: the store also holds the access log and
+      // the negotiated link rate, which outlive the fingerprints
       fingerprint_names_.clear();
+      name_store_.save(fingerprint_names_);
+      // Saved even without a hot set, so a stale map can't come back with one
+      hot_set_.reset();
+      hot_set_.save();
+      uint8_t page[NOTEPAD_PAGE_SIZE] = {0};
+      if (finger_.write_notepad(SLOT_MAP_PAGE, page) == CONFIRM_OK) {
+        slots_moved_ = false;
+      }
+      slot_map_lost_ = false;
+      occupancy_.clear_all();
       
       if (status_sensor_ != nullptr) {
         status_sensor_->publish_state("All fingerprints cleared");
@@ -222,16 +674,189 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
   
  protected:
   static constexpr const char *TAG = "fingerprint_sensor";
+  static constexpr uint32_t LOOP_TIME_WINDOW_MS = 10000;
+  static constexpr uint32_t HEAP_INTERVAL_MS = 60000;
+  static constexpr uint32_t FLASH_DAY_MS = 24 * 60 * 60 * 1000;
+  static constexpr uint32_t BUS_STATS_INTERVAL_MS = 10000;
+  static constexpr uint32_t TASK_STACK_SIZE = 4096;
+  // Template moves per compaction run, each is three sensor commands
+  static constexpr uint8_t HOT_SET_MOVES_PER_RUN = 4;
+  // Restored templates held in RAM until written, about 2 kB each
+  static constexpr uint8_t RESTORE_QUEUE_DEPTH = 2;
+  // Longest the sensor task sleeps between passes when nothing touched the ring
+  static constexpr uint32_t TASK_IDLE_WAIT_MS = 10;
+  // How long to keep polling after a touch edge while the ring pin has
+  // not (yet) reported the finger as resting on the sensor
+  static constexpr uint32_t TOUCH_BURST_MS = 1000;
+  static constexpr uint8_t LINK_CHECK_ROUND_TRIPS = 16;
+  static constexpr const char *BAUD_RATE_KEY = "baud";
+  // Notepad page marking moved templates; page 0 holds the pairing code
+  static constexpr uint8_t SLOT_MAP_PAGE = 1;
+  static constexpr uint32_t SLOT_MAP_MARK = 0x314D5348;  // "HSM1"
+  // Presence poll while a decided finger rests on the sensor, without a ring pin
+  static constexpr uint32_t LIFT_POLL_MS = 250;
+  // How long the ring pin must stay released before the finger counts as lifted
+  static constexpr uint32_t LIFT_DEBOUNCE_MS = 150;
   
-  Adafruit_Fingerprint finger_ = Adafruit_Fingerprint(&Serial2);
-  Preferences preferences_;
-  std::map<int, std::string> fingerprint_names_;
-  bool connected_ = false;
-  bool enrolling_ = false;
-  int enroll_id_ = 0;
-  std::string enroll_name_;
+  // Steps of a single scan. loop() advances at most one step per pass so
+  // that every sensor round trip is followed by a return to the main loop.
+  // With other readers on the loop a step doesn't even wait for its reply.
+  enum class ScanState : uint8_t {
+    IDLE,         // Polling getImage() every scan interval of the profile
+    CONVERT,      // Image captured, image2Tz() pending
+    RECAPTURE,    // Attempt of a burst failed, getImage() again while the finger stays
+    SEARCH,       // Template ready, fingerSearch() pending
+    SEARCH_REST,  // Not in the hot set, search the remaining slots
+    COOLDOWN,     // Decision published, holding off the next capture
+    HELD,         // Waiting for the decided finger to lift before scanning again
+  };
+  
+  // What the scan path found, handed to publishing. With the sensor task
+  // these cross from the task to loop() through events_.
+  enum class ScanEventType : uint8_t {
+    CAPTURED,   // Image taken, decision follows
+    MATCH,
+    NO_MATCH,
+    BAD_IMAGE,
+    CLEARED,    // Finger gone, decision withdrawn
+  };
+  
+  struct ScanEvent {
+    ScanEventType type;
+    uint16_t id;
+    uint16_t confidence;
+    // Images taken after the first for this decision
+    uint8_t retries;
+  };
+  
+  static constexpr uint32_t ENROLL_POLL_MS = 50;
+  static constexpr uint32_t ENROLL_SETTLE_MS = 500;
+  static constexpr uint32_t ENROLL_PASS_HOLD_MS = 1000;
+  
+  // Steps of an enrollment session, advanced one sensor command per loop()
+  enum class EnrollPhase : uint8_t {
+    IDLE,          // No enrollment running
+    WAIT_LIFT,     // Waiting for the finger of the previous pass to leave
+    SETTLE,        // Short pause after lifting
+    WAIT_FINGER,   // Polling getImage() for the next pass
+    CONVERT,       // image2Tz(pass) pending
+    PASS_DONE,     // Solid LED for a moment before the next pass
+    CREATE_MODEL,  // createModel() pending
+    STORE,         // storeModel() pending
+  };
+  
+  struct EnrollmentSession {
+    EnrollPhase phase = EnrollPhase::IDLE;
+    int id = 0;
+    std::string name;
+    uint8_t pass = 0;
+    uint32_t phase_start = 0;
+    uint32_t pass_start = 0;
+    uint32_t last_poll = 0;
+  };
+  
+  SensorProtocol finger_;
+  SensorTransport *transport_{nullptr};
+  Clock *clock_{nullptr};
+  KeyValueStore *store_{nullptr};
+  NameStore name_store_;
+  HotSet hot_set_;
+  LibraryBackup backup_;
+  CallbackManager<void(const std::string &, int, int, const std::string &, uint32_t)> backup_chunk_callback_;
+  CallbackManager<void(int, bool)> restore_progress_callback_;
+  OccupancyMap occupancy_;
+  uint16_t backup_next_id_ = 0;
+  uint16_t backup_sent_ = 0;
+  bool backup_running_ = false;
+  uint16_t restore_written_ = 0;
+  uint16_t restore_unchanged_ = 0;
+  // Restored templates waiting for their bus job, and which restore they belong to
+  uint8_t restore_queued_ = 0;
+  uint32_t restore_generation_ = 0;
+  uint16_t hot_set_size_ = 0;
+  uint32_t compaction_interval_ms_ = 600000;
+  LedManager led_;
+  MatchEvent match_event_;
+  PowerSave power_save_;
+  uint32_t power_save_interval_ms_ = 60000;
+  AccessLog access_log_;
+  uint32_t access_log_flush_ms_ = 600000;
+  uint32_t access_log_interval_ms_ = 60000;
+  uint32_t flash_day_start_ = 0;
+  CallbackManager<void(const std::string &, uint32_t, int)> access_log_batch_callback_;
+  uint32_t idle_since_ = 0;
+  bool led_sleeping_ = false;
+  SensorBus bus_;
+  SensorEmulator *emulator_{nullptr};
+  SystemClock system_clock_;
+  SensorScheduler own_scheduler_;
+  SensorScheduler *scheduler_{nullptr};
+  uint8_t member_ = 0;
+  const char *storage_namespace_ = "fingerprints";
+  CallbackManager<void(ScanResult, int, int)> scan_result_callback_;
+  StageTimings stage_timings_;
+  // Scan steps timed on the sensor task, only touched under sensor_lock_
+  StageTimings task_stage_timings_;
+  uint32_t stage_timing_interval_ms_ = 60000;
+  MemoryStore memory_store_;
+  UartTransport uart_transport_;
+#ifdef USE_ARDUINO
+  PreferencesStore preferences_store_;
+#endif
+  NameTable fingerprint_names_;
+  // Reused for every match so publishing does not allocate once warmed up
+  std::string match_name_;
+  std::string match_status_;
+  std::atomic<bool> connected_{false};
+  SensorLink link_;
+  SensorProfile profile_ = SensorProfile::of<R503Profile>();
+  uint32_t link_baud_rate_ = R503Profile::BAUD_RATE;
+  uint32_t saved_baud_rate_ = 0;
+  uint32_t max_baud_rate_ = 0;
+  bool baud_switchable_ = false;
+  bool baud_negotiated_ = false;
+  uint32_t round_trip_us_ = 0;
+  CallbackManager<void()> connected_callback_;
+  EnrollmentSession enroll_;
+  uint32_t enroll_timeout_ms_ = 30000;
   unsigned long last_scan_time_ = 0;
   bool last_ring_state_ = false;
+  bool matches_blocked_ = false;
+  // Compaction moved templates on this sensor, see load_slot_map()
+  bool slots_moved_ = false;
+  bool slot_map_lost_ = false;
+  std::atomic<ScanState> scan_state_{ScanState::IDLE};
+  uint32_t cooldown_start_ = 0;
+  uint32_t cooldown_ms_ = 0;
+  uint32_t match_cooldown_ms_ = 3000;
+  uint32_t ring_cooldown_ms_ = 1000;
+  uint32_t lift_start_ = 0;
+  bool lifting_ = false;
+  uint8_t burst_attempts_ = 1;
+  uint32_t burst_time_ms_ = 1500;
+  uint32_t burst_start_ = 0;
+  uint8_t burst_attempt_ = 0;
+  bool burst_searched_ = false;
+  uint32_t burst_rescued_ = 0;
+  // When the command of the current scan step went out
+  uint32_t step_start_ = 0;
+  uint32_t loop_time_max_us_ = 0;
+  InternalGPIOPin *touch_pin_{nullptr};
+  volatile bool touch_pending_ = false;
+  uint32_t touch_burst_start_ = 0;
+  
+  // Sensor task mode
+  bool task_enabled_ = false;
+  uint8_t task_core_ = 0;
+  uint8_t task_priority_ = 5;
+#ifdef USE_ESP32
+  TaskHandle_t task_handle_{nullptr};
+#endif
+  SensorLock sensor_lock_;
+  SpscRing<ScanEvent, 16> events_;
+  uint32_t events_dropped_reported_ = 0;
+  // Mirrors enroll_.phase != IDLE for the sensor task
+  std::atomic<bool> enrolling_{false};
   
   sensor::Sensor *match_id_sensor_{nullptr};
   text_sensor::TextSensor *match_name_sensor_{nullptr};
@@ -239,224 +864,1305 @@ class FingerprintSensor : public Component, public uart::UARTDevice {
   sensor::Sensor *enrolled_count_sensor_{nullptr};
   text_sensor::TextSensor *status_sensor_{nullptr};
   binary_sensor::BinarySensor *ring_sensor_{nullptr};
+  sensor::Sensor *loop_time_sensor_{nullptr};
+  sensor::Sensor *link_rate_sensor_{nullptr};
+  sensor::Sensor *round_trip_sensor_{nullptr};
+  sensor::Sensor *queue_depth_sensor_{nullptr};
+  sensor::Sensor *uart_errors_sensor_{nullptr};
+  sensor::Sensor *heap_free_sensor_{nullptr};
+  sensor::Sensor *heap_max_block_sensor_{nullptr};
+  sensor::Sensor *enroll_progress_sensor_{nullptr};
+  sensor::Sensor *awake_sensor_{nullptr};
+  sensor::Sensor *wakeups_sensor_{nullptr};
+  sensor::Sensor *wake_latency_sensor_{nullptr};
+  sensor::Sensor *flash_written_sensor_{nullptr};
+  sensor::Sensor *burst_retries_sensor_{nullptr};
+  sensor::Sensor *burst_rescued_sensor_{nullptr};
+  sensor::Sensor *stage_sensors_[STAGE_COUNT][STAGE_STAT_COUNT] = {};
+#ifdef USE_SWITCH
+  switch_::Switch *ignore_touch_ring_switch_{nullptr};
+#endif
   
-  void load_fingerprint_names() {
-    // Load all stored fingerprint names from preferences
-    for (int i = 1; i <= 200; i++) {
-      String key = String(i);
-      if (preferences_.isKey(key.c_str())) {
-        String name = preferences_.getString(key.c_str(), "");
-        if (name.length() > 0) {
-          fingerprint_names_[i] = name.c_str();
-          ESP_LOGD(TAG, "Loaded ID %d: %s", i, name.c_str());
-        }
-      }
+  static void IRAM_ATTR touch_isr(FingerprintSensor *arg) {
+    arg->touch_pending_ = true;
+#ifdef USE_ESP32
+    if (arg->task_handle_ != nullptr) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(arg->task_handle_, &woken);
+      portYIELD_FROM_ISR(woken);
     }
-    ESP_LOGI(TAG, "Loaded %d fingerprint names from memory", fingerprint_names_.size());
+#endif
   }
   
-  void scan_fingerprint() {
-    // Don't scan too frequently
-    unsigned long current_time = millis();
-    if (current_time - last_scan_time_ < 100) {
+  bool task_running() const {
+#ifdef USE_ESP32
+    return task_handle_ != nullptr;
+#else
+    return false;
+#endif
+  }
+  
+  bool scan_in_progress() const {
+    ScanState state = scan_state_;
+    return state == ScanState::CONVERT || state == ScanState::RECAPTURE || state == ScanState::SEARCH ||
+           state == ScanState::SEARCH_REST;
+  }
+  
+  // At most one sensor command per pass. A running enrollment owns the
+  // sensor, but a scan that is already converting/searching finishes first
+  // so its template buffer isn't overwritten underneath it.
+  void sensor_pass(bool scan) {
+    if (finger_.busy()) {
+      // A scan step waits for its reply, the UART is taken until it is in
+      if (scan) {
+        scan_fingerprint();
+      }
       return;
     }
-    last_scan_time_ = current_time;
-    
-    // Check for finger on sensor
-    uint8_t result = finger_.getImage();
-    
-    if (result == FINGERPRINT_NOFINGER) {
-      // No finger detected
-      if (last_ring_state_) {
-        // Reset ring state
-        last_ring_state_ = false;
-        if (ring_sensor_ != nullptr) {
-          ring_sensor_->publish_state(false);
-        }
-        if (match_id_sensor_ != nullptr) {
-          match_id_sensor_->publish_state(-1);
-        }
-        if (match_name_sensor_ != nullptr) {
-          match_name_sensor_->publish_state("");
-        }
-        if (confidence_sensor_ != nullptr) {
-          confidence_sensor_->publish_state(0);
-        }
-        
-        // Return LED to ready
-        finger_.LEDcontrol(FINGERPRINT_LED_BREATHING, 250, FINGERPRINT_LED_BLUE);
-      }
+    uint32_t round_trips = finger_.stats().round_trips;
+    bool enrolling = enroll_.phase != EnrollPhase::IDLE && !scan_in_progress();
+    if (scan && !enrolling) {
+      scan_fingerprint();
+    }
+    if (finger_.stats().round_trips != round_trips || finger_.busy()) {
       return;
     }
-    
-    if (result != FINGERPRINT_OK) {
-      // Error getting image
+    // The rest blocks, so it waits until no other reader is mid-scan
+    if (!scheduler_->take_turn(member_, enrolling || led_.pending() || bus_.pending())) {
       return;
     }
-    
-    // Image captured, show LED feedback
-    finger_.LEDcontrol(FINGERPRINT_LED_FLASHING, 25, FINGERPRINT_LED_RED, 0);
-    
-    // Convert image to template
-    result = finger_.image2Tz();
-    if (result != FINGERPRINT_OK) {
-      if (result == FINGERPRINT_IMAGEMESS) {
-        ESP_LOGW(TAG, "Image too messy");
-      } else if (result == FINGERPRINT_FEATUREFAIL || result == FINGERPRINT_INVALIDIMAGE) {
-        ESP_LOGW(TAG, "Could not find fingerprint features");
+    if (enrolling) {
+      step_enrollment();
+    }
+    // LED updates and queued commands only go out on passes that left the UART idle
+    if (finger_.stats().round_trips == round_trips) {
+      if (led_.pending()) {
+        timed(STAGE_LED, [this]() { return led_.flush(); });
+      } else {
+        bus_.run_next();
       }
+    }
+    scheduler_->done(member_);
+  }
+  
+#ifdef USE_ESP32
+  void start_sensor_task() {
+    sensor_lock_.enable();
+    if (xTaskCreatePinnedToCore(&FingerprintSensor::sensor_task, "fingerprint", TASK_STACK_SIZE, this,
+                                task_priority_, &task_handle_, task_core_) != pdPASS) {
+      ESP_LOGE(TAG, "Could not start the sensor task, scanning from loop()");
+      task_handle_ = nullptr;
       return;
     }
-    
-    // Search for matching fingerprint
-    result = finger_.fingerSearch();
-    
-    if (result == FINGERPRINT_OK) {
-      // Match found!
-      int id = finger_.fingerID;
-      int confidence = finger_.confidence;
-      
-      ESP_LOGI(TAG, "Match found! ID: %d, Confidence: %d", id, confidence);
-      
-      // Get name from stored names
-      std::string name = "Unknown";
-      if (fingerprint_names_.find(id) != fingerprint_names_.end()) {
-        name = fingerprint_names_[id];
+    ESP_LOGI(TAG, "Scanning from a task on core %u", task_core_);
+  }
+  
+  static void sensor_task(void *arg) {
+    auto *self = static_cast<FingerprintSensor *>(arg);
+    self->system_clock_.set_yield_task(xTaskGetCurrentTaskHandle());
+    while (true) {
+      bool busy;
+      {
+        std::lock_guard<SensorLock> guard(self->sensor_lock_);
+        uint32_t round_trips = self->finger_.stats().round_trips;
+        // Enrollment runs from loop(), leave the sensor to it between scans
+        if (self->connected_ && (!self->enrolling_ || self->scan_in_progress())) {
+          self->scan_fingerprint();
+        }
+        busy = self->finger_.stats().round_trips != round_trips;
       }
-      
-      // Publish to Home Assistant
-      if (match_id_sensor_ != nullptr) {
-        match_id_sensor_->publish_state(id);
+      // Right on to the next step of a scan, otherwise sleep until a touch or the next poll
+      ulTaskNotifyTake(pdTRUE, busy ? 1 : pdMS_TO_TICKS(TASK_IDLE_WAIT_MS));
+    }
+  }
+#endif
+  
+  void emit(const ScanEvent &event) {
+    if (task_running()) {
+      events_.push(event);
+    } else {
+      handle_scan_event(event);
+    }
+  }
+  
+  void handle_scan_event(const ScanEvent &event) {
+    switch (event.type) {
+      case ScanEventType::CAPTURED:
+        // LED feedback goes out once the search is done
+        led_.request(LED_EVENT_SCANNING);
+        break;
+      case ScanEventType::MATCH:
+        power_save_.decided(clock_->micros());
+        publish_retries(event.retries, true);
+        publish_match(event.id, event.confidence);
+        break;
+      case ScanEventType::NO_MATCH:
+        power_save_.decided(clock_->micros());
+        publish_retries(event.retries, false);
+        publish_ring();
+        break;
+      case ScanEventType::BAD_IMAGE:
+        publish_retries(event.retries, false);
+        led_.request(LED_EVENT_ERROR);
+        // Held back for the batching window, the retry usually replaces it
+        match_event_.add("bad_image", -1, "", 0, clock_->millis(), false);
+        scan_result_callback_.call(ScanResult::BAD_IMAGE, -1, 0);
+        break;
+      case ScanEventType::CLEARED:
+        publish_cleared();
+        break;
+    }
+  }
+  
+  // Run one sensor command and record its round trip under the given stage
+  template<typename F> uint8_t timed(Stage stage, F &&command) {
+    ScopedStageTimer timer(&stage_timings_, clock_, stage);
+    return command();
+  }
+  
+  // One round trip of the scan path, recorded under the given stage. With
+  // other readers on the loop, send() goes out on one pass and the reply is
+  // picked up on a later one; CONFIRM_PENDING until it is complete.
+  template<typename F> uint8_t scan_step(Stage stage, F &&send) {
+    if (!finger_.busy()) {
+      step_start_ = clock_->micros();
+      send();
+    }
+    uint8_t result = split_scans() ? finger_.poll() : finger_.wait();
+    if (result != CONFIRM_PENDING) {
+      (task_running() ? task_stage_timings_ : stage_timings_).record(stage, clock_->micros() - step_start_);
+    }
+    return result;
+  }
+  
+  // A sensor task has the core to itself and a lone reader nobody to wait for
+  bool split_scans() const { return scheduler_->members() > 1 && !task_running(); }
+  
+  
+  bool has_stage_sensors() const {
+    for (auto &stage : stage_sensors_) {
+      for (auto *sensor : stage) {
+        if (sensor != nullptr) {
+          return true;
+        }
       }
-      if (match_name_sensor_ != nullptr) {
-        match_name_sensor_->publish_state(name);
+    }
+    return false;
+  }
+  
+  void publish_stage_timings() {
+    // Fold in the task's scan steps while it is between commands. If it is
+    // mid-command they stay where they are and go out with the next window.
+    if (sensor_lock_.try_lock()) {
+      stage_timings_.merge(task_stage_timings_);
+      task_stage_timings_.reset();
+      sensor_lock_.unlock();
+    }
+    for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+      const LatencyHistogram &histogram = stage_timings_.get(Stage(stage));
+      if (histogram.count() == 0) {
+        continue;
       }
-      if (confidence_sensor_ != nullptr) {
-        confidence_sensor_->publish_state(confidence);
+      sensor::Sensor **sensors = stage_sensors_[stage];
+      if (sensors[STAGE_STAT_P50] != nullptr) {
+        sensors[STAGE_STAT_P50]->publish_state(histogram.percentile(0.50f) / 1000.0f);
       }
-      if (ring_sensor_ != nullptr) {
-        ring_sensor_->publish_state(false); // Not a ring event
+      if (sensors[STAGE_STAT_P95] != nullptr) {
+        sensors[STAGE_STAT_P95]->publish_state(histogram.percentile(0.95f) / 1000.0f);
       }
-      
-      // Purple LED for match
-      finger_.LEDcontrol(FINGERPRINT_LED_ON, 0, FINGERPRINT_LED_PURPLE);
-      
-      if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Match: " + name);
+      if (sensors[STAGE_STAT_MAX] != nullptr) {
+        sensors[STAGE_STAT_MAX]->publish_state(histogram.max() / 1000.0f);
       }
-      last_ring_state_ = true;
-      
-      // Wait a bit before next scan
-      delay(3000);
-      
-    } else if (result == FINGERPRINT_NOTFOUND) {
-      // No match found - ring doorbell!
-      ESP_LOGI(TAG, "No match found - ring doorbell!");
-      
-      // Publish ring event to Home Assistant
-      if (ring_sensor_ != nullptr) {
-        ring_sensor_->publish_state(true);
+    }
+    stage_timings_.reset();
+  }
+  
+  // Touch wake is used when a ring pin is configured, unless the ring is
+  // being ignored (e.g. rain mode), in which case we fall back to polling
+  bool touch_wake_enabled() const {
+    if (touch_pin_ == nullptr) {
+      return false;
+    }
+#ifdef USE_SWITCH
+    if (ignore_touch_ring_switch_ != nullptr && ignore_touch_ring_switch_->state) {
+      return false;
+    }
+#endif
+    return true;
+  }
+  
+  // Decide whether the idle state should talk to the sensor in this pass
+  bool should_capture(uint32_t current_time) {
+    if (!touch_wake_enabled()) {
+      // Polling mode: don't scan too frequently
+      return current_time - last_scan_time_ >= profile_.scan_interval_ms;
+    }
+    
+    if (touch_pending_) {
+      // Fresh touch: capture right away, independent of the poll phase
+      touch_pending_ = false;
+      touch_burst_start_ = current_time;
+      return true;
+    }
+    
+    bool touched = touch_pin_->digital_read();
+    bool in_burst = current_time - touch_burst_start_ < TOUCH_BURST_MS;
+    if (!touched && !in_burst) {
+      // Ring reports the finger as gone, no need to ask the sensor
+      if (last_ring_state_) {
+        reset_decision();
       }
-      if (match_id_sensor_ != nullptr) {
-        match_id_sensor_->publish_state(-1);
+      return false;
+    }
+    return current_time - last_scan_time_ >= profile_.scan_interval_ms;
+  }
+  /**
+   * Nap in light sleep once nothing has happened for idle_after: no scan,
+   * enrollment or queued work, and nobody at the ring. The LED goes dark
+   * first. A touch wakes straight into a capture, the rest of the loop
+   * follows after it.
+   */
+  void manage_power() {
+    uint32_t now = clock_->millis();
+    if (!sleep_ready(now)) {
+      idle_since_ = now;
+      led_sleeping_ = false;
+      return;
+    }
+    if (now - idle_since_ < power_save_.idle_after()) {
+      return;
+    }
+    if (!led_sleeping_) {
+      led_sleeping_ = true;
+      led_.request(LED_EVENT_SLEEP);
+    }
+    if (led_.pending()) {
+      // Goes out on the next pass
+      return;
+    }
+    
+    bool touched;
+    {
+      // Keeps the sensor task out until the nap is over
+      std::lock_guard<SensorLock> guard(sensor_lock_);
+      touched = power_save_.nap(touch_pin_, clock_);
+    }
+    if (!touched) {
+      return;
+    }
+    touch_pending_ = true;
+#ifdef USE_ESP32
+    if (task_handle_ != nullptr) {
+      xTaskNotifyGive(task_handle_);
+      return;
+    }
+#endif
+    sensor_pass(true);
+  }
+  
+  bool sleep_ready(uint32_t now) {
+    return connected_ && touch_wake_enabled() && scan_state_ == ScanState::IDLE && !finger_.busy() &&
+           enroll_.phase == EnrollPhase::IDLE && !backup_running_ && !bus_.pending() && !touch_pending_ &&
+           !last_ring_state_ && now - touch_burst_start_ >= TOUCH_BURST_MS && !touch_pin_->digital_read();
+  }
+  
+  void publish_power_save() {
+    uint32_t now = clock_->micros();
+    if (awake_sensor_ != nullptr) {
+      awake_sensor_->publish_state(power_save_.awake_percent(now));
+    }
+    if (wakeups_sensor_ != nullptr) {
+      wakeups_sensor_->publish_state(power_save_.wakeups());
+    }
+    const LatencyHistogram &latency = power_save_.wake_latency();
+    if (wake_latency_sensor_ != nullptr && latency.count() > 0) {
+      wake_latency_sensor_->publish_state(latency.percentile(0.50f) / 1000.0f);
+    }
+    power_save_.reset_window(now);
+  }
+  
+  void publish_bus_stats() {
+    if (queue_depth_sensor_ != nullptr) {
+      queue_depth_sensor_->publish_state(bus_.take_max_depth());
+    }
+    if (uart_errors_sensor_ != nullptr) {
+      const ProtocolStats &stats = finger_.stats();
+      uart_errors_sensor_->publish_state(stats.timeouts + stats.bad_packets);
+    }
+  }
+  
+  // Only the ESP32 heap is reported, elsewhere the sensors stay unknown
+  void publish_heap() {
+#ifdef USE_ESP32
+    if (heap_free_sensor_ != nullptr) {
+      heap_free_sensor_->publish_state(heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    }
+    if (heap_max_block_sensor_ != nullptr) {
+      heap_max_block_sensor_->publish_state(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    }
+#endif
+  }
+  
+  // Probe for the sensor when due. Once it answers, read everything that lives on it.
+  void try_connect() {
+    uint32_t now = clock_->millis();
+    if (!link_.probe_due(now)) {
+      return;
+    }
+    // The sensor task must not scan before the library is loaded
+    std::lock_guard<SensorLock> guard(sensor_lock_);
+    uint32_t baud_rate = probe_baud_rate();
+    if (baud_rate != link_baud_rate_ && transport_->set_baud_rate(baud_rate)) {
+      link_baud_rate_ = baud_rate;
+    }
+    if (!finger_.verify_password(SensorLink::PROBE_TIMEOUT_MS)) {
+      link_.probe_failed(now);
+      // Complain once every rate has had its try
+      if (link_.failed_probes() == (alternate_baud_rate() != 0 ? 2 : 1)) {
+        ESP_LOGE(TAG, "Fingerprint sensor not found, retrying in the background");
+        if (status_sensor_ != nullptr) {
+          status_sensor_->publish_state("Sensor not found!");
+        }
+      } else {
+        ESP_LOGD(TAG, "Sensor still not answering, next try in %u ms", link_.retry_ms());
       }
-      if (match_name_sensor_ != nullptr) {
-        match_name_sensor_->publish_state("");
+      return;
+    }
+    
+    ESP_LOGI(TAG, "Fingerprint sensor found!");
+    ESP_LOGI(TAG, "Model: %s", profile_.name);
+    finger_.get_parameters();
+    if (finger_.capacity() > profile_.capacity) {
+      ESP_LOGW(TAG, "Sensor reports %u templates, more than an %s holds, using %u", finger_.capacity(),
+               profile_.name, profile_.capacity);
+      finger_.set_capacity(profile_.capacity);
+    }
+    ESP_LOGI(TAG, "Capacity: %d", finger_.capacity());
+    ESP_LOGI(TAG, "Security level: %d", finger_.security_level());
+    
+    if (baud_switchable_ && !baud_negotiated_ && max_baud_rate_ > link_baud_rate_) {
+      if (!negotiate_baud_rate()) {
+        link_.probe_failed(now);
+        return;
       }
-      if (confidence_sensor_ != nullptr) {
-        confidence_sensor_->publish_state(0);
+    } else {
+      check_link();
+    }
+    ESP_LOGI(TAG, "Link: %u baud, %.1f ms per round trip", link_baud_rate_, round_trip_us_ / 1000.0f);
+    if (link_rate_sensor_ != nullptr) {
+      link_rate_sensor_->publish_state(link_baud_rate_);
+    }
+    if (round_trip_sensor_ != nullptr) {
+      round_trip_sensor_->publish_state(round_trip_us_ / 1000.0f);
+    }
+    
+    // Which IDs hold templates, and their names from preferences
+    load_library();
+    
+    scan_state_ = ScanState::IDLE;
+    // The sensor may have been power cycled, its LED shows whatever it booted with
+    led_.invalidate();
+    led_.request(LED_EVENT_READY);
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state("Ready");
+    }
+    link_.connected();
+    connected_ = true;
+    connected_callback_.call();
+  }
+  
+  // While looking for the sensor, alternate between the rate it was last
+  // moved to (or is about to be moved to) and its factory default
+  uint32_t probe_baud_rate() const {
+    uint32_t alternate = alternate_baud_rate();
+    return alternate != 0 && link_.failed_probes() % 2 == 0 ? alternate : profile_.baud_rate;
+  }
+  uint32_t alternate_baud_rate() const {
+    uint32_t rate = saved_baud_rate_ != 0 ? saved_baud_rate_ : max_baud_rate_;
+    return baud_switchable_ && rate != profile_.baud_rate ? rate : 0;
+  }
+  
+  /**
+   * Move both sides to max_baud_rate, once per boot. The new rate is kept and
+   * saved only if a burst of round trips comes back clean; otherwise both go
+   * back to the default. Returns false if the sensor is unreachable after that.
+   */
+  bool negotiate_baud_rate() {
+    baud_negotiated_ = true;
+    uint32_t target = max_baud_rate_;
+    ESP_LOGI(TAG, "Trying %u baud", target);
+    if (finger_.set_baud_rate(target) != CONFIRM_OK) {
+      ESP_LOGW(TAG, "Sensor refused %u baud, staying at %u", target, link_baud_rate_);
+      check_link();
+      return true;
+    }
+    transport_->set_baud_rate(target);
+    link_baud_rate_ = target;
+    if (check_link()) {
+      ESP_LOGI(TAG, "Link now runs at %u baud", target);
+      save_baud_rate(target);
+      return true;
+    }
+    
+    ESP_LOGW(TAG, "Link unreliable at %u baud, falling back to %u", target, profile_.baud_rate);
+    // The request may arrive even if its reply doesn't
+    finger_.set_baud_rate(profile_.baud_rate);
+    transport_->set_baud_rate(profile_.baud_rate);
+    link_baud_rate_ = profile_.baud_rate;
+    if (!check_link()) {
+      // Probing tries both rates from here
+      ESP_LOGE(TAG, "Sensor did not come back at %u baud", profile_.baud_rate);
+      return false;
+    }
+    save_baud_rate(profile_.baud_rate);
+    return true;
+  }
+  
+  // A burst of round trips that must all come back clean. Measures the round trip time.
+  bool check_link() {
+    uint32_t bad_packets = finger_.stats().bad_packets;
+    uint32_t start = clock_->micros();
+    for (uint8_t i = 0; i < LINK_CHECK_ROUND_TRIPS; i++) {
+      if (!finger_.verify_password(SensorLink::PROBE_TIMEOUT_MS)) {
+        return false;
       }
-      
+    }
+    if (finger_.stats().bad_packets != bad_packets) {
+      return false;
+    }
+    round_trip_us_ = (clock_->micros() - start) / LINK_CHECK_ROUND_TRIPS;
+    return true;
+  }
+  
+  void save_baud_rate(uint32_t baud_rate) {
+    saved_baud_rate_ = baud_rate;
+    uint8_t data[4];
+    put_le32(data, baud_rate);
+    if (!store_->put_bytes(BAUD_RATE_KEY, data, sizeof(data))) {
+      ESP_LOGW(TAG, "Could not save the link rate");
+    }
+  }
+  
+  void connection_lost() {
+    std::lock_guard<SensorLock> guard(sensor_lock_);
+    ESP_LOGE(TAG, "Fingerprint sensor stopped answering, reconnecting");
+    connected_ = false;
+    link_.lost(clock_->millis());
+    scheduler_->set_scanning(member_, false);
+    if (enroll_.phase != EnrollPhase::IDLE) {
+      finish_enrollment(false, "Error: Sensor lost");
+    }
+    scan_state_ = ScanState::IDLE;
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state("Sensor not found!");
+    }
+  }
+  
+  void load_library() {
+    // Load all stored fingerprint names from preferences in one read
+    fingerprint_names_.init(finger_.capacity());
+    match_name_.reserve(NameTable::MAX_NAME_LENGTH);
+    match_status_.reserve(NameTable::MAX_NAME_LENGTH + 7);
+    if (!name_store_.load(fingerprint_names_)) {
+      ESP_LOGW(TAG, "Could not load fingerprint names");
+    }
+    ESP_LOGI(TAG, "Loaded %d fingerprint names from memory", fingerprint_names_.size());
+    
+    load_slot_map();
+    
+    // One index table read instead of asking about every slot
+    occupancy_.init(finger_.capacity());
+    std::vector<uint8_t> slots;
+    if (!read_occupancy(slots)) {
+      ESP_LOGE(TAG, "Could not read the sensor's index table");
+      return;
+    }
+    for (uint16_t slot = 1; slot < finger_.capacity(); slot++) {
+      if (bit_set(slots, slot)) {
+        occupancy_.set(hot_set_.id_of(slot));
+      }
+    }
+    ESP_LOGI(TAG, "Sensor contains %d templates", occupancy_.count());
+    publish_enrolled_count();
+    
+    // Without the map (or its mark) which ID a slot holds is a guess, and the
+    // name of a moved template would look orphaned. Keep every name for the restore.
+    if (slot_map_lost_) {
+      return;
+    }
+    
+    // Names left behind by templates deleted elsewhere, e.g. by the original firmware
+    std::vector<uint16_t> orphans;
+    fingerprint_names_.for_each([this, &orphans](uint16_t id, const char *, uint8_t) {
+      if (!occupancy_.test(id)) {
+        orphans.push_back(id);
+      }
+    });
+    for (uint16_t id : orphans) {
+      ESP_LOGW(TAG, "Dropping the name of ID %u, the sensor has no template for it", id);
+      fingerprint_names_.erase(id);
+    }
+    if (!orphans.empty()) {
+      name_store_.save(fingerprint_names_);
+    }
+  }
+  
+  /**
+   * Which slot holds which ID. Before compaction first moves a template it
+   * marks SLOT_MAP_PAGE of the sensor's notepad; from then on the map in
+   * flash is the only record of the arrangement, and a sensor so marked
+   * without a usable map has no safe answer. Matches would come out under
+   * another person's ID, so they are blocked instead, and so is everything
+   * that addresses templates by ID, until the library is cleared.
+   */
+  void load_slot_map() {
+    hot_set_.init(finger_.capacity(), hot_set_size_);
+    slot_map_lost_ = false;
+    uint8_t page[NOTEPAD_PAGE_SIZE];
+    uint8_t result = finger_.read_notepad(SLOT_MAP_PAGE, page);
+    if (result != CONFIRM_OK) {
+      // Can't tell whether identity is safe, so it isn't used for matches
+      ESP_LOGE(TAG, "Could not read the slot map mark, code: %d. Matches are blocked.", result);
+      slot_map_lost_ = true;
+      return;
+    }
+    slots_moved_ = get_le32(page) == SLOT_MAP_MARK;
+    if (!slots_moved_ && !hot_set_.enabled()) {
+      return;
+    }
+    bool loaded = hot_set_.load();
+    if (slots_moved_ && (!loaded || !hot_set_.found())) {
+      ESP_LOGE(TAG, "Templates on the sensor were moved but the slot map is lost, matches are blocked. "
+                    "Clear all fingerprints and restore a backup.");
+      hot_set_.init(finger_.capacity(), hot_set_size_);
+      slot_map_lost_ = true;
       if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Doorbell ring!");
+        status_sensor_->publish_state("Slot map lost!");
       }
-      
-      // Trigger doorbell output (will be handled by automation in Home Assistant)
-      last_ring_state_ = true;
-      
-      delay(1000);
+    } else if (!loaded) {
+      // Nothing was ever moved on this sensor, so the identity mapping is right
+      ESP_LOGW(TAG, "Could not load the hot set, using the enrolled IDs as slots");
+    } else if (!slots_moved_ && !hot_set_.identity()) {
+      // Moved before the mark existed
+      mark_slots_moved();
+    }
+  }
+  
+  bool mark_slots_moved() {
+    uint8_t page[NOTEPAD_PAGE_SIZE] = {0};
+    put_le32(page, SLOT_MAP_MARK);
+    if (finger_.write_notepad(SLOT_MAP_PAGE, page) != CONFIRM_OK) {
+      ESP_LOGW(TAG, "Could not mark the sensor's slots as moved");
+      return false;
     }
+    slots_moved_ = true;
+    return true;
   }
   
-  int perform_enrollment(int id) {
-    ESP_LOGI(TAG, "Starting enrollment for ID %d", id);
+  // Refuses with an error while the slot map is lost
+  bool check_slot_map(const char *action) {
+    if (!slot_map_lost_) {
+      return true;
+    }
+    ESP_LOGE(TAG, "Cannot %s, the slot map is lost", action);
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state("Error: Slot map lost");
+    }
+    return false;
+  }
+  
+  void publish_enrolled_count() {
+    if (enrolled_count_sensor_ != nullptr) {
+      enrolled_count_sensor_->publish_state(occupancy_.count());
+    }
+  }
+  
+  // Runs as a bus job, so nothing else talks to the sensor in between. Moves
+  // copy through char buffer 2; buffer 1 may hold a scan's template.
+  void run_hot_set_compaction() {
+    if (slot_map_lost_) {
+      // Saving now would turn the guess into a valid looking map
+      return;
+    }
+    uint32_t hot = hot_set_.hot_hits();
+    uint32_t total = hot + hot_set_.cold_hits();
+    if (total > 0) {
+      ESP_LOGD(TAG, "Hot set found %u of %u matches in the first %u slots", hot, total, hot_set_.size());
+    }
     
-    // Enroll in 5 passes
-    for (int pass = 1; pass <= 5; pass++) {
-      ESP_LOGI(TAG, "Enrollment pass %d/5", pass);
-      if (status_sensor_ != nullptr) {
-        status_sensor_->publish_state("Enrollment pass " + std::to_string(pass) + "/5: Place finger");
+    if (!enrolling_ && !scan_in_progress()) {
+      // A move keeps the ID's template, so occupancy by ID stays right throughout
+      auto occupied = [this](uint16_t slot) { return occupancy_.test(hot_set_.id_of(slot)); };
+      uint16_t from, to;
+      for (uint8_t moves = 0; moves < HOT_SET_MOVES_PER_RUN; moves++) {
+        if (!hot_set_.plan_move(occupied, &from, &to) || !move_template(from, to)) {
+          break;
+        }
       }
-      
-      // Wait for no finger on sensor (except first pass)
-      if (pass > 1) {
-        finger_.LEDcontrol(FINGERPRINT_LED_BREATHING, 100, FINGERPRINT_LED_PURPLE);
-        while (finger_.getImage() != FINGERPRINT_NOFINGER) {
-          delay(50);
+    }
+    
+    hot_set_.decay();
+    if (hot_set_.dirty()) {
+      hot_set_.save();
+    }
+  }
+  
+  // Fills bitmap with one bit per occupied template slot
+  bool read_occupancy(std::vector<uint8_t> &bitmap) {
+    bitmap.assign((finger_.capacity() / 8) + 1, 0);
+    for (uint8_t page = 0; page * INDEX_TABLE_PAGE_SIZE < bitmap.size(); page++) {
+      uint8_t table[INDEX_TABLE_PAGE_SIZE];
+      if (finger_.read_index_table(page, table) != CONFIRM_OK) {
+        return false;
+      }
+      size_t offset = page * INDEX_TABLE_PAGE_SIZE;
+      memcpy(&bitmap[offset], table, std::min<size_t>(INDEX_TABLE_PAGE_SIZE, bitmap.size() - offset));
+    }
+    return true;
+  }
+  
+  static bool bit_set(const std::vector<uint8_t> &bitmap, uint16_t bit) {
+    return (bitmap[bit / 8] & (1 << (bit % 8))) != 0;
+  }
+  
+  void continue_backup() {
+    if (!bus_.submit_job(BUS_PRIORITY_LOW, [this](SensorProtocol &) { backup_next_template(); })) {
+      ESP_LOGE(TAG, "Backup aborted, sensor command queue is full");
+      backup_running_ = false;
+    }
+  }
+  
+  // Bus job: export one template, then queue the next
+  void backup_next_template() {
+    if (enrolling_) {
+      // The export would overwrite a pass in char buffer 2, try again later
+      continue_backup();
+      return;
+    }
+    uint16_t capacity = finger_.capacity();
+    while (backup_next_id_ < capacity && !occupancy_.test(backup_next_id_)) {
+      backup_next_id_++;
+    }
+    if (backup_next_id_ >= capacity) {
+      backup_.emit("end", 0, backup_sent_, "");
+      ESP_LOGI(TAG, "Backup complete, %u templates", backup_sent_);
+      backup_running_ = false;
+      return;
+    }
+    
+    uint16_t id = backup_next_id_++;
+    uint8_t result = backup_.export_template(finger_, id, hot_set_.slot_of(id));
+    if (result != CONFIRM_OK) {
+      // The restore side notices the missing template_end and aborts
+      ESP_LOGE(TAG, "Backup aborted at ID %u, code: %d", id, result);
+      backup_running_ = false;
+      return;
+    }
+    backup_sent_++;
+    continue_backup();
+  }
+  
+  // Bus job: write one restored template
+  void restore_next_template(int id, const std::vector<uint8_t> &data, uint32_t generation) {
+    restore_queued_--;
+    if (!backup_.importing() || generation != restore_generation_) {
+      // An earlier write failed and ended the import
+      return;
+    }
+    uint16_t slot = hot_set_.slot_of(id);
+    bool written;
+    uint8_t result = LibraryBackup::write_template(finger_, slot, data, &written);
+    if (result != CONFIRM_OK) {
+      ESP_LOGE(TAG, "Restoring ID %d failed with code: %d", id, result);
+      finish_restore("Restore failed!");
+      return;
+    }
+    if (written) {
+      hot_set_.forget(slot);
+      occupancy_.set(id);
+      restore_written_++;
+    } else {
+      restore_unchanged_++;
+    }
+    restore_progress_callback_.call(id, written);
+  }
+  
+  // Bus job: all templates are in, apply names and sections
+  void complete_restore(uint32_t generation) {
+    if (!backup_.importing() || generation != restore_generation_) {
+      return;
+    }
+    fingerprint_names_.clear();
+    for (auto &name : backup_.imported_names()) {
+      fingerprint_names_.set(name.first, name.second);
+    }
+    name_store_.save(fingerprint_names_);
+    backup_.restore_sections();
+    ESP_LOGI(TAG, "Restore complete: %u templates written, %u unchanged", restore_written_, restore_unchanged_);
+    finish_restore("Restore complete");
+  }
+  
+  void finish_restore(const char *message) {
+    backup_.end_import();
+    publish_enrolled_count();
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state(message);
+    }
+  }
+  
+  // Copy a template into a free slot, then drop the original. The mapping is
+  // saved in between, so a power cut leaves at worst a stray copy behind.
+  bool move_template(uint16_t from, uint16_t to) {
+    uint16_t id = hot_set_.id_of(from);
+    if (!slots_moved_ && !mark_slots_moved()) {
+      return false;
+    }
+    if (finger_.load_model(from, 2) != CONFIRM_OK || finger_.store_model(to, 2) != CONFIRM_OK) {
+      ESP_LOGW(TAG, "Could not move ID %u from slot %u to %u", id, from, to);
+      return false;
+    }
+    hot_set_.moved(from, to);
+    if (!hot_set_.save()) {
+      // Keep both copies, the old mapping still points at a valid one
+      hot_set_.moved(to, from);
+      return false;
+    }
+    if (finger_.delete_model(from) != CONFIRM_OK) {
+      ESP_LOGW(TAG, "Could not delete the old copy of ID %u in slot %u", id, from);
+      return false;
+    }
+    ESP_LOGI(TAG, "Moved ID %u from slot %u to %u", id, from, to);
+    return true;
+  }
+  
+  void scan_fingerprint() {
+    uint32_t current_time = clock_->millis();
+    ScanState state = scan_state_;
+    switch (state) {
+      case ScanState::IDLE:
+        // A capture already sent only needs its reply
+        if (!finger_.busy()) {
+          if (!should_capture(current_time)) {
+            return;
+          }
+          last_scan_time_ = current_time;
+        }
+        capture_image();
+        break;
+      case ScanState::CONVERT:
+        convert_image(current_time);
+        break;
+      case ScanState::RECAPTURE:
+        recapture_image(current_time);
+        break;
+      case ScanState::SEARCH:
+      case ScanState::SEARCH_REST:
+        search_template(current_time);
+        break;
+      case ScanState::COOLDOWN:
+        // Wait a bit, then only scan again once this finger is gone
+        if (current_time - cooldown_start_ >= cooldown_ms_) {
+          lifting_ = false;
+          scan_state_ = ScanState::HELD;
         }
-        delay(500);
+        break;
+      case ScanState::HELD:
+        wait_for_lift(current_time);
+        break;
+    }
+    // A split step sends the next command as soon as its reply is in, not a pass later
+    if (split_scans() && scan_state_ != state && scan_in_progress() && !finger_.busy()) {
+      scan_fingerprint();
+      return;
+    }
+    scheduler_->set_scanning(member_, finger_.busy() || scan_in_progress());
+  }
+  
+  /**
+   * One touch gets one decision. While the finger that got it keeps resting
+   * on the sensor there is nothing to convert or search, so this only checks
+   * for presence: the ring pin when it is usable, otherwise a getImage() now
+   * and then, whose result is never converted.
+   */
+  void wait_for_lift(uint32_t current_time) {
+    if (touch_wake_enabled() && !finger_.busy()) {
+      if (touch_pin_->digital_read()) {
+        lifting_ = false;
+        return;
       }
-      
-      // Flash LED to indicate ready for finger
-      finger_.LEDcontrol(FINGERPRINT_LED_FLASHING, 25, FINGERPRINT_LED_PURPLE, 0);
-      
-      // Wait for finger on sensor
-      uint8_t result = FINGERPRINT_NOFINGER;
-      while (result != FINGERPRINT_OK) {
-        result = finger_.getImage();
-        if (result == FINGERPRINT_PACKETRECIEVEERR || result == FINGERPRINT_IMAGEFAIL) {
-          ESP_LOGE(TAG, "Error capturing image");
-          return result;
+      if (!lifting_) {
+        lifting_ = true;
+        lift_start_ = current_time;
+      }
+      if (current_time - lift_start_ < LIFT_DEBOUNCE_MS) {
+        return;
+      }
+    } else {
+      if (!finger_.busy()) {
+        if (current_time - last_scan_time_ < LIFT_POLL_MS) {
+          return;
         }
-        delay(50);
+        last_scan_time_ = current_time;
       }
-      
-      ESP_LOGI(TAG, "Image captured");
-      
-      // Convert image to template
-      result = finger_.image2Tz(pass);
-      if (result != FINGERPRINT_OK) {
-        ESP_LOGE(TAG, "Error converting image: %d", result);
-        return result;
+      uint8_t result = scan_step(STAGE_GET_IMAGE, [this]() { finger_.send<GetImage>(); });
+      if (result != CONFIRM_NO_FINGER) {
+        // Still there, not answered yet, or no answer; ask again next time
+        return;
       }
+    }
+    
+    ESP_LOGD(TAG, "Finger lifted %u ms after the decision", (unsigned) (current_time - cooldown_start_));
+    // Edges while it rested were the same finger
+    touch_pending_ = false;
+    scan_state_ = ScanState::IDLE;
+    if (last_ring_state_) {
+      reset_decision();
+    }
+  }
+  
+  void capture_image() {
+    // Check for finger on sensor
+    uint8_t result = scan_step(STAGE_GET_IMAGE, [this]() { finger_.send<GetImage>(); });
+    if (result == CONFIRM_PENDING) {
+      return;
+    }
+    
+    if (result == CONFIRM_NO_FINGER) {
+      // No finger detected
+      if (last_ring_state_) {
+        reset_decision();
+      }
+      return;
+    }
+    
+    if (result != CONFIRM_OK) {
+      // Error getting image
+      return;
+    }
+    
+    emit({ScanEventType::CAPTURED, 0, 0});
+    burst_start_ = clock_->millis();
+    burst_attempt_ = 1;
+    burst_searched_ = false;
+    scan_state_ = ScanState::CONVERT;
+  }
+  
+  // Next image of a burst. The finger is still down, so no poll interval.
+  void recapture_image(uint32_t current_time) {
+    uint8_t result = scan_step(STAGE_GET_IMAGE, [this]() { finger_.send<GetImage>(); });
+    if (result == CONFIRM_PENDING) {
+      return;
+    }
+    if (result == CONFIRM_OK) {
+      scan_state_ = ScanState::CONVERT;
+    } else if (result == CONFIRM_NO_FINGER) {
+      // Lifted before this attempt, decide on the ones taken
+      ESP_LOGD(TAG, "Finger lifted during the burst");
+      burst_attempt_--;
+      end_burst(current_time);
+    } else {
+      attempt_failed(current_time, false);
+    }
+  }
+  
+  /**
+   * Burst capture: one poor image shouldn't ring the doorbell on a resident.
+   * A failed conversion or search takes another image while the finger stays
+   * down, until the attempt or time budget runs out. The sensor doesn't grade
+   * its images, so the best one is simply the first that matches.
+   */
+  void attempt_failed(uint32_t current_time, bool searched) {
+    burst_searched_ = burst_searched_ || searched;
+    if (burst_attempt_ < burst_attempts_ && current_time - burst_start_ < burst_time_ms_) {
+      ESP_LOGD(TAG, "Attempt %u of %u failed, capturing again", burst_attempt_, burst_attempts_);
+      burst_attempt_++;
+      scan_state_ = ScanState::RECAPTURE;
+      return;
+    }
+    end_burst(current_time);
+  }
+  
+  // Every attempt failed: ring if any image got as far as a search
+  void end_burst(uint32_t current_time) {
+    uint8_t retries = burst_attempt_ > 0 ? burst_attempt_ - 1 : 0;
+    if (burst_searched_) {
+      ESP_LOGI(TAG, "No match found - ring doorbell!");
+      emit({ScanEventType::NO_MATCH, 0, 0, retries});
+      last_ring_state_ = true;
+      start_cooldown(current_time, ring_cooldown_ms_);
+    } else {
+      emit({ScanEventType::BAD_IMAGE, 0, 0, retries});
+      scan_state_ = ScanState::IDLE;
+    }
+  }
+  
+  void reset_decision() {
+    // Reset ring state
+    last_ring_state_ = false;
+    emit({ScanEventType::CLEARED, 0, 0});
+  }
+  
+  void publish_cleared() {
+    {
+      ScopedStageTimer timer(&stage_timings_, clock_, STAGE_PUBLISH);
+      publish_changed(ring_sensor_, false);
+      publish_changed(match_id_sensor_, -1);
+      publish_changed(match_name_sensor_, "");
+      publish_changed(confidence_sensor_, 0);
+    }
+    
+    // Return LED to ready
+    led_.request(LED_EVENT_READY);
+  }
+  
+  void convert_image(uint32_t current_time) {
+    // Convert image to template
+    uint8_t slot = 1;
+    uint8_t result = scan_step(STAGE_IMAGE2TZ, [this, slot]() { finger_.send_image_to_tz(slot); });
+    if (result == CONFIRM_PENDING) {
+      return;
+    }
+    if (result != CONFIRM_OK) {
+      if (result == CONFIRM_IMAGE_MESS) {
+        ESP_LOGW(TAG, "Image too messy");
+      } else if (result == CONFIRM_FEATURE_FAIL || result == CONFIRM_INVALID_IMAGE) {
+        ESP_LOGW(TAG, "Could not find fingerprint features");
+      }
+      attempt_failed(current_time, false);
+      return;
+    }
+    scan_state_ = ScanState::SEARCH;
+  }
+  
+  void search_template(uint32_t current_time) {
+    // Search for matching fingerprint. With a hot set, its few slots go
+    // first and the rest of the library is searched on the next pass.
+    uint8_t result;
+    if (!hot_set_.enabled()) {
+      result = scan_step(STAGE_SEARCH, [this]() { finger_.send_search(1, 0, finger_.capacity()); });
+    } else if (scan_state_ == ScanState::SEARCH) {
+      result = scan_step(STAGE_SEARCH, [this]() { finger_.send_search(1, 0, hot_set_.hot_pages()); });
+      if (result == CONFIRM_NOT_FOUND && hot_set_.hot_pages() < finger_.capacity()) {
+        scan_state_ = ScanState::SEARCH_REST;
+        return;
+      }
+    } else {
+      uint16_t start = hot_set_.hot_pages();
+      result = scan_step(STAGE_SEARCH, [this, start]() { finger_.send_search(1, start, finger_.capacity() - start); });
+    }
+    if (result == CONFIRM_PENDING) {
+      return;
+    }
+    
+    if (result == CONFIRM_OK) {
+      // Match found!
+      hot_set_.record_hit(finger_.finger_id());
+      emit({ScanEventType::MATCH, hot_set_.id_of(finger_.finger_id()), finger_.confidence(),
+            uint8_t(burst_attempt_ - 1)});
+      last_ring_state_ = true;
+      start_cooldown(current_time, match_cooldown_ms_);
       
-      // Solid LED to indicate success
-      finger_.LEDcontrol(FINGERPRINT_LED_ON, 0, FINGERPRINT_LED_PURPLE);
-      delay(1000);
+    } else if (result == CONFIRM_NOT_FOUND) {
+      // Rings unless another image of the burst matches
+      attempt_failed(current_time, true);
       
-      ESP_LOGI(TAG, "Pass %d complete", pass);
+    } else {
+      scan_state_ = ScanState::IDLE;
+    }
+  }
+  
+  void publish_ring() {
+    log_access(AccessResult::RING, -1, 0);
+    // Publish ring event to Home Assistant
+    {
+      ScopedStageTimer timer(&stage_timings_, clock_, STAGE_PUBLISH);
+      match_event_.add("ring", -1, "", 0, clock_->millis(), true);
+      publish_changed(ring_sensor_, true);
+      publish_changed(match_id_sensor_, -1);
+      publish_changed(match_name_sensor_, "");
+      publish_changed(confidence_sensor_, 0);
+      publish_status("Doorbell ring!");
     }
     
-    // Create model from the 5 images
-    ESP_LOGI(TAG, "Creating fingerprint model");
-    if (status_sensor_ != nullptr) {
-      status_sensor_->publish_state("Creating fingerprint model...");
+    // Trigger doorbell output (will be handled by automation in Home Assistant)
+    led_.request(LED_EVENT_RING);
+    scan_result_callback_.call(ScanResult::NO_MATCH, -1, 0);
+  }
+  
+  void publish_match(int id, int confidence) {
+    if (matches_blocked()) {
+      publish_blocked(id, confidence);
+      return;
+    }
+    log_access(AccessResult::MATCH, id, confidence);
+    ESP_LOGI(TAG, "Match found! ID: %d, Confidence: %d", id, confidence);
+    
+    // Get name from stored names
+    if (fingerprint_names_.contains(id)) {
+      match_name_.assign(fingerprint_names_.get(id), fingerprint_names_.length(id));
+    } else {
+      match_name_.assign("Unknown");
     }
     
-    uint8_t result = finger_.createModel();
-    if (result != FINGERPRINT_OK) {
-      ESP_LOGE(TAG, "Error creating model: %d", result);
-      if (result == FINGERPRINT_ENROLLMISMATCH) {
-        ESP_LOGE(TAG, "Fingerprints did not match");
+    // Publish to Home Assistant
+    {
+      ScopedStageTimer timer(&stage_timings_, clock_, STAGE_PUBLISH);
+      match_event_.add("match", id, match_name_, confidence, clock_->millis(), true);
+      publish_changed(match_id_sensor_, id);
+      publish_changed(match_name_sensor_, match_name_);
+      publish_changed(confidence_sensor_, confidence);
+      publish_changed(ring_sensor_, false);  // Not a ring event
+      if (status_sensor_ != nullptr) {
+        match_status_.assign("Match: ").append(match_name_);
+        publish_status(match_status_);
       }
-      return result;
     }
     
-    // Store model
-    ESP_LOGI(TAG, "Storing fingerprint model at ID %d", id);
+    // Purple LED for match
+    led_.request(LED_EVENT_MATCH);
+    scan_result_callback_.call(ScanResult::MATCH, id, confidence);
+  }
+  
+  // A match that must not open the door: no match entities, only the refusal
+  void publish_blocked(int id, int confidence) {
+    ESP_LOGW(TAG, "Match on ID %d blocked, %s", id,
+             slot_map_lost_ ? "the slot map is lost" : "the sensor is not trusted");
+    log_access(AccessResult::BLOCKED, id, confidence);
+    {
+      ScopedStageTimer timer(&stage_timings_, clock_, STAGE_PUBLISH);
+      match_event_.add("blocked", -1, "", 0, clock_->millis(), true);
+      publish_changed(ring_sensor_, false);
+      publish_status("Match blocked");
+    }
+    led_.request(LED_EVENT_ERROR);
+    scan_result_callback_.call(ScanResult::BLOCKED, id, confidence);
+  }
+  
+  // Retries of every decision, and the matches they saved from a ring or a bad image
+  void publish_retries(uint8_t retries, bool matched) {
+    if (retries > 0 && matched) {
+      ESP_LOGI(TAG, "Matched on image %u of the burst", retries + 1);
+      burst_rescued_++;
+      if (burst_rescued_sensor_ != nullptr) {
+        burst_rescued_sensor_->publish_state(burst_rescued_);
+      }
+    }
+    if (burst_retries_sensor_ != nullptr) {
+      burst_retries_sensor_->publish_state(retries);
+    }
+  }
+  
+  void log_access(AccessResult result, int id, int confidence) {
+    if (access_log_.enabled()) {
+      access_log_.append(result, id, confidence, match_event_.now());
+    }
+  }
+  
+  // Flash written by the access log today, starting over every 24 hours
+  void publish_flash_written() {
+    flash_written_sensor_->publish_state(access_log_.bytes_written());
+    uint32_t now = clock_->millis();
+    if (now - flash_day_start_ >= FLASH_DAY_MS) {
+      access_log_.reset_bytes_written();
+      flash_day_start_ = now;
+    }
+  }
+  
+  // Each publish is an API message, so entities only get one when their value changes
+  static void publish_changed(sensor::Sensor *sensor, float value) {
+    if (sensor != nullptr && !(sensor->has_state() && sensor->get_raw_state() == value)) {
+      sensor->publish_state(value);
+    }
+  }
+  static void publish_changed(text_sensor::TextSensor *sensor, const std::string &value) {
+    if (sensor != nullptr && !(sensor->has_state() && sensor->get_raw_state() == value)) {
+      sensor->publish_state(value);
+    }
+  }
+  static void publish_changed(binary_sensor::BinarySensor *sensor, bool value) {
+    if (sensor != nullptr && !(sensor->has_state() && sensor->state == value)) {
+      sensor->publish_state(value);
+    }
+  }
+  // Except the status, published on every decision: the same visitor
+  // twice in a row is two events, and automations on the status must see both
+  void publish_status(const std::string &status) {
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state(status);
+    }
+  }
+  
+  void start_cooldown(uint32_t current_time, uint32_t cooldown_ms) {
+    cooldown_start_ = current_time;
+    cooldown_ms_ = cooldown_ms;
+    scan_state_ = ScanState::COOLDOWN;
+  }
+  
+  void set_enroll_phase(EnrollPhase phase, uint32_t current_time) {
+    enroll_.phase = phase;
+    enroll_.phase_start = current_time;
+  }
+  
+  void start_enroll_pass(uint8_t pass, uint32_t current_time) {
+    enroll_.pass = pass;
+    enroll_.pass_start = current_time;
+    
+    ESP_LOGI(TAG, "Enrollment pass %d/%d", pass, profile_.enroll_passes);
     if (status_sensor_ != nullptr) {
-      status_sensor_->publish_state("Storing fingerprint...");
+      status_sensor_->publish_state("Enrollment pass " + std::to_string(pass) + "/" +
+                                   std::to_string(profile_.enroll_passes) + ": Place finger");
     }
     
-    result = finger_.storeModel(id);
-    if (result != FINGERPRINT_OK) {
-      ESP_LOGE(TAG, "Error storing model: %d", result);
-      return result;
+    if (pass > 1) {
+      // Wait for no finger on sensor (except first pass)
+      led_.request(LED_EVENT_ENROLL_LIFT);
+      set_enroll_phase(EnrollPhase::WAIT_LIFT, current_time);
+    } else {
+      // Flash LED to indicate ready for finger
+      led_.request(LED_EVENT_ENROLL_PLACE);
+      set_enroll_phase(EnrollPhase::WAIT_FINGER, current_time);
     }
+  }
+  
+  void step_enrollment() {
+    uint32_t current_time = clock_->millis();
+    uint8_t result;
     
-    ESP_LOGI(TAG, "Enrollment complete!");
-    return 0;
+    switch (enroll_.phase) {
+      case EnrollPhase::IDLE:
+        return;
+        
+      case EnrollPhase::WAIT_LIFT:
+      case EnrollPhase::WAIT_FINGER:
+        // Nobody at the sensor: give up instead of waiting forever
+        if (current_time - enroll_.pass_start > enroll_timeout_ms_) {
+          ESP_LOGE(TAG, "Enrollment pass %d timed out", enroll_.pass);
+          finish_enrollment(false, "Enrollment timed out");
+          return;
+        }
+        if (current_time - enroll_.last_poll < ENROLL_POLL_MS) {
+          return;
+        }
+        enroll_.last_poll = current_time;
+        result = timed(STAGE_ENROLL_IMAGE, [this]() { return finger_.get_image(); });
+        
+        if (enroll_.phase == EnrollPhase::WAIT_LIFT) {
+          if (result == CONFIRM_NO_FINGER) {
+            set_enroll_phase(EnrollPhase::SETTLE, current_time);
+          }
+          return;
+        }
+        if (result == CONFIRM_PACKET_RECEIVE_ERR || result == CONFIRM_IMAGE_FAIL) {
+          ESP_LOGE(TAG, "Error capturing image");
+          finish_enrollment(false, "Enrollment failed!");
+          return;
+        }
+        if (result == CONFIRM_OK) {
+          ESP_LOGI(TAG, "Image captured");
+          set_enroll_phase(EnrollPhase::CONVERT, current_time);
+        }
+        return;
+        
+      case EnrollPhase::SETTLE:
+        if (current_time - enroll_.phase_start >= ENROLL_SETTLE_MS) {
+          // Flash LED to indicate ready for finger
+          led_.request(LED_EVENT_ENROLL_PLACE);
+          set_enroll_phase(EnrollPhase::WAIT_FINGER, current_time);
+        }
+        return;
+        
+      case EnrollPhase::CONVERT:
+        // Convert image to template
+        result = timed(STAGE_ENROLL_CONVERT, [this]() { return finger_.image_to_tz(enroll_.pass); });
+        if (result != CONFIRM_OK) {
+          ESP_LOGE(TAG, "Error converting image: %d", result);
+          finish_enrollment(false, "Enrollment failed!");
+          return;
+        }
+        complete_enroll_pass(current_time);
+        return;
+        
+      case EnrollPhase::PASS_DONE:
+        if (current_time - enroll_.phase_start < ENROLL_PASS_HOLD_MS) {
+          return;
+        }
+        if (enroll_.pass < profile_.enroll_passes) {
+          start_enroll_pass(enroll_.pass + 1, current_time);
+        } else {
+          // Create model from the images of all passes
+          ESP_LOGI(TAG, "Creating fingerprint model");
+          if (status_sensor_ != nullptr) {
+            status_sensor_->publish_state("Creating fingerprint model...");
+          }
+          set_enroll_phase(EnrollPhase::CREATE_MODEL, current_time);
+        }
+        return;
+        
+      case EnrollPhase::CREATE_MODEL:
+        result = timed(STAGE_ENROLL_MODEL, [this]() { return finger_.create_model(); });
+        if (result != CONFIRM_OK) {
+          ESP_LOGE(TAG, "Error creating model: %d", result);
+          if (result == CONFIRM_ENROLL_MISMATCH) {
+            ESP_LOGE(TAG, "Fingerprints did not match");
+          }
+          finish_enrollment(false, "Enrollment failed!");
+          return;
+        }
+        
+        // Store model
+        ESP_LOGI(TAG, "Storing fingerprint model at ID %d", enroll_.id);
+        if (status_sensor_ != nullptr) {
+          status_sensor_->publish_state("Storing fingerprint...");
+        }
+        set_enroll_phase(EnrollPhase::STORE, current_time);
+        return;
+        
+      case EnrollPhase::STORE:
+        result = timed(STAGE_ENROLL_MODEL, [this]() { return finger_.store_model(hot_set_.slot_of(enroll_.id)); });
+        if (result != CONFIRM_OK) {
+          ESP_LOGE(TAG, "Error storing model: %d", result);
+          finish_enrollment(false, "Enrollment failed!");
+          return;
+        }
+        finish_enrollment(true, "Enrollment successful!");
+        return;
+    }
+  }
+  
+  void complete_enroll_pass(uint32_t current_time) {
+    // Solid LED to indicate success
+    led_.request(LED_EVENT_ENROLL_PASS);
+    ESP_LOGI(TAG, "Pass %d complete", enroll_.pass);
+    if (enroll_progress_sensor_ != nullptr) {
+      enroll_progress_sensor_->publish_state(enroll_.pass * 100.0f / (profile_.enroll_passes + 1));
+    }
+    set_enroll_phase(EnrollPhase::PASS_DONE, current_time);
+  }
+  
+  void finish_enrollment(bool success, const char *message) {
+    if (success) {
+      ESP_LOGI(TAG, "Enrollment complete!");
+      
+      // Save name to preferences
+      fingerprint_names_.set(enroll_.id, enroll_.name);
+      name_store_.save(fingerprint_names_);
+      
+      occupancy_.set(enroll_.id);
+      publish_enrolled_count();
+    }
+    
+    if (status_sensor_ != nullptr) {
+      status_sensor_->publish_state(message);
+    }
+    if (enroll_progress_sensor_ != nullptr) {
+      enroll_progress_sensor_->publish_state(success ? 100 : 0);
+    }
+    
+    enroll_ = EnrollmentSession();
+    enrolling_ = false;
+    
+    // Return LED to ready state
+    led_.request(LED_EVENT_READY);
   }
 };
 
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include "esphome/core/log.h"
+#include "sensor_hal.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Keeps the most used templates in the lowest slots of the sensor library,
+ * so that searching a small page range first usually finds the finger.
+ *
+ * IDs are what users enroll, delete and see as match ID; they never change.
+ * Slots are where the sensor actually keeps a template. slot_of() and id_of()
+ * translate between the two, and compaction changes the mapping when it moves
+ * a template. Every match adds to the score of its slot, and scores halve on
+ * every compaction run, so the hot set follows recent use.
+ *
+ * Persisted as one blob (little endian), alternating between two keys like
+ * the name table:
+ *   magic u32 | version u8 | reserved u8 | slot_count u16 | generation u32
+ *   slot_count x (id u16, score u16)
+ *   checksum u32 (FNV-1a over everything before it)
+ *
+ * Once templates have moved, this map is the only record of which slot holds
+ * which ID. FingerprintSensor marks that on the sensor itself, so a lost map
+ * is noticed instead of read as the identity mapping.
+ */
+class HotSet {
+ public:
+  static constexpr uint32_t MAGIC = 0x31544F48;  // "HOT1"
+  static constexpr uint8_t VERSION = 1;
+  static constexpr size_t HEADER_SIZE = 12;
+  static constexpr size_t ENTRY_SIZE = 4;
+  static constexpr size_t CHECKSUM_SIZE = 4;
+  static constexpr uint16_t HIT_SCORE = 16;
+
+  void set_store(KeyValueStore *store) { store_ = store; }
+
+  // Identity mapping for the sensor's pages 0..capacity - 1. Slots 1..size are the hot range.
+  void init(uint16_t capacity, uint16_t size) {
+    size_ = size < capacity ? size : (capacity > 0 ? capacity - 1 : 0);
+    entries_.resize(capacity);
+    reset();
+  }
+
+  bool enabled() const { return size_ > 0; }
+  uint16_t size() const { return size_; }
+  uint16_t capacity() const { return entries_.size(); }
+  // Search pages covering the hot range; slot 0 is never enrolled but keeps the range simple
+  uint16_t hot_pages() const { return size_ + 1; }
+  bool is_hot(uint16_t slot) const { return slot >= 1 && slot <= size_; }
+
+  uint16_t slot_of(uint16_t id) const {
+    if (id >= entries_.size()) {
+      return id;
+    }
+    return slots_[id];
+  }
+  uint16_t id_of(uint16_t slot) const {
+    if (slot >= entries_.size()) {
+      return slot;
+    }
+    return entries_[slot].id;
+  }
+  uint16_t score(uint16_t slot) const { return slot < entries_.size() ? entries_[slot].score : 0; }
+
+  void record_hit(uint16_t slot) {
+    if (slot >= entries_.size()) {
+      return;
+    }
+    uint16_t &score = entries_[slot].score;
+    score = score > UINT16_MAX - HIT_SCORE ? UINT16_MAX : score + HIT_SCORE;
+    if (is_hot(slot)) {
+      hot_hits_++;
+    } else {
+      cold_hits_++;
+    }
+    dirty_ = true;
+  }
+
+  // The template of this slot was deleted
+  void forget(uint16_t slot) {
+    if (slot < entries_.size() && entries_[slot].score != 0) {
+      entries_[slot].score = 0;
+      dirty_ = true;
+    }
+  }
+
+  // Halve all scores so old hits count less than recent ones
+  void decay() {
+    for (auto &entry : entries_) {
+      if (entry.score != 0) {
+        entry.score /= 2;
+        dirty_ = true;
+      }
+    }
+  }
+
+  /**
+   * Pick the next template move. `occupied(slot)` tells whether the sensor has
+   * a template in that slot. Promotes the hottest template outside the hot
+   * range into a free hot slot; with none free, first evicts the coldest hot
+   * template to a free slot outside, if the newcomer is clearly hotter.
+   */
+  template<typename F> bool plan_move(F &&occupied, uint16_t *from, uint16_t *to) const {
+    uint16_t capacity = this->capacity();
+    uint16_t hottest = 0;
+    for (uint16_t slot = size_ + 1; slot < capacity; slot++) {
+      if (occupied(slot) && entries_[slot].score > entries_[hottest].score) {
+        hottest = slot;
+      }
+    }
+    if (hottest == 0) {
+      return false;
+    }
+
+    uint16_t coldest = 0;
+    for (uint16_t slot = 1; slot <= size_; slot++) {
+      if (!occupied(slot)) {
+        *from = hottest;
+        *to = slot;
+        return true;
+      }
+      if (coldest == 0 || entries_[slot].score < entries_[coldest].score) {
+        coldest = slot;
+      }
+    }
+    // Hysteresis, so two similar fingers don't keep trading places
+    if (coldest == 0 || entries_[hottest].score <= 2 * uint32_t(entries_[coldest].score)) {
+      return false;
+    }
+    for (uint16_t slot = size_ + 1; slot < capacity; slot++) {
+      if (!occupied(slot)) {
+        *from = coldest;
+        *to = slot;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // The template in `from` now sits in the previously free slot `to`
+  void moved(uint16_t from, uint16_t to) {
+    Entry empty = entries_[to];
+    entries_[to] = entries_[from];
+    entries_[from] = empty;
+    slots_[entries_[to].id] = to;
+    slots_[entries_[from].id] = from;
+    dirty_ = true;
+  }
+
+  // Library emptied: back to identity, all scores gone
+  void reset() {
+    slots_.resize(entries_.size());
+    for (uint16_t slot = 0; slot < entries_.size(); slot++) {
+      entries_[slot] = Entry{slot, 0};
+      slots_[slot] = slot;
+    }
+    dirty_ = true;
+  }
+
+  bool dirty() const { return dirty_; }
+  uint32_t hot_hits() const { return hot_hits_; }
+  uint32_t cold_hits() const { return cold_hits_; }
+
+  // Whether the last load() found a stored map, valid or not
+  bool found() const { return found_; }
+  bool identity() const {
+    for (uint16_t slot = 0; slot < entries_.size(); slot++) {
+      if (entries_[slot].id != slot) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool load() {
+    uint32_t generation[2] = {0, 0};
+    std::vector<uint8_t> blobs[2];
+    bool valid[2] = {read_copy(KEYS[0], blobs[0], &generation[0]), read_copy(KEYS[1], blobs[1], &generation[1])};
+    found_ = valid[0] || valid[1] || store_->is_key(KEYS[0]) || store_->is_key(KEYS[1]);
+    uint8_t pick;
+    if (valid[1] && (!valid[0] || int32_t(generation[1] - generation[0]) > 0)) {
+      pick = 1;
+    } else if (valid[0]) {
+      pick = 0;
+    } else {
+      // Nothing stored yet, the identity mapping is right; both copies broken, it may not be
+      return !found_;
+    }
+
+    const std::vector<uint8_t> &blob = blobs[pick];
+    if (get_le16(&blob[6]) != entries_.size()) {
+      ESP_LOGW(TAG, "Ignoring slot map for a different sensor capacity");
+      return false;
+    }
+    const uint8_t *entry = &blob[HEADER_SIZE];
+    for (uint16_t slot = 0; slot < entries_.size(); slot++, entry += ENTRY_SIZE) {
+      uint16_t id = get_le16(entry);
+      if (id >= entries_.size()) {
+        ESP_LOGW(TAG, "Ignoring slot map with invalid ID %u", id);
+        reset();
+        return false;
+      }
+      entries_[slot] = Entry{id, get_le16(entry + 2)};
+      slots_[id] = slot;
+    }
+    generation_ = generation[pick];
+    active_ = pick;
+    dirty_ = false;
+    ESP_LOGD(TAG, "Loaded slot map generation %u from %s", generation_, KEYS[active_]);
+    return true;
+  }
+
+  bool save() {
+    std::vector<uint8_t> blob(HEADER_SIZE + entries_.size() * ENTRY_SIZE + CHECKSUM_SIZE, 0);
+    put_le32(&blob[0], MAGIC);
+    blob[4] = VERSION;
+    put_le16(&blob[6], entries_.size());
+    put_le32(&blob[8], generation_ + 1);
+    uint8_t *entry = &blob[HEADER_SIZE];
+    for (auto &slot : entries_) {
+      put_le16(entry, slot.id);
+      put_le16(entry + 2, slot.score);
+      entry += ENTRY_SIZE;
+    }
+    put_le32(entry, blob_checksum(blob.data(), blob.size() - CHECKSUM_SIZE));
+
+    uint8_t target = active_ ^ 1;
+    if (!store_->put_bytes(KEYS[target], blob.data(), blob.size())) {
+      ESP_LOGE(TAG, "Writing slot map to %s failed", KEYS[target]);
+      return false;
+    }
+    active_ = target;
+    generation_++;
+    dirty_ = false;
+    return true;
+  }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_sensor.hot_set";
+  static constexpr const char *KEYS[2] = {"hot_a", "hot_b"};
+
+  struct Entry {
+    uint16_t id;
+    uint16_t score;
+  };
+
+  bool read_copy(const char *key, std::vector<uint8_t> &blob, uint32_t *generation) {
+    size_t length = store_->get_bytes_length(key);
+    if (length < HEADER_SIZE + CHECKSUM_SIZE) {
+      return false;
+    }
+    blob.resize(length);
+    if (store_->get_bytes(key, blob.data(), length) != length) {
+      return false;
+    }
+    const uint8_t *header = blob.data();
+    if (get_le32(header) != MAGIC || header[4] != VERSION ||
+        HEADER_SIZE + get_le16(header + 6) * ENTRY_SIZE + CHECKSUM_SIZE != length ||
+        get_le32(header + length - CHECKSUM_SIZE) != blob_checksum(header, length - CHECKSUM_SIZE)) {
+      ESP_LOGW(TAG, "Ignoring invalid slot map in %s", key);
+      return false;
+    }
+    *generation = get_le32(header + 8);
+    return true;
+  }
+
+  KeyValueStore *store_{nullptr};
+  bool found_ = false;
+  // Indexed by slot
+  std::vector<Entry> entries_;
+  // Indexed by ID
+  std::vector<uint16_t> slots_;
+  uint16_t size_ = 0;
+  uint32_t generation_ = 0;
+  uint8_t active_ = 1;  // So the very first save goes to KEYS[0]
+  bool dirty_ = false;
+  uint32_t hot_hits_ = 0;
+  uint32_t cold_hits_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include "sensor_protocol.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+// Situations with their own ring LED pattern, in the order of LED_EVENTS in __init__.py
+enum LedEvent : uint8_t {
+  LED_EVENT_READY,
+  LED_EVENT_SCANNING,
+  LED_EVENT_MATCH,
+  LED_EVENT_RING,
+  LED_EVENT_ERROR,
+  LED_EVENT_ENROLL_PLACE,
+  LED_EVENT_ENROLL_LIFT,
+  LED_EVENT_ENROLL_PASS,
+  LED_EVENT_SLEEP,
+  LED_EVENT_COUNT,
+};
+
+struct LedProfile {
+  uint8_t mode;
+  uint8_t speed;
+  uint8_t color;
+  uint8_t count;
+
+  bool operator==(const LedProfile &other) const {
+    return mode == other.mode && speed == other.speed && color == other.color && count == other.count;
+  }
+  bool operator!=(const LedProfile &other) const { return !(*this == other); }
+};
+
+/**
+ * Keeps LED control off the sensor's critical path.
+ *
+ * request() only records the wanted pattern. flush() sends it, and the
+ * component calls that on loop passes that left the UART idle, so a command
+ * never sits between getImage and search. Requests made while the sensor is
+ * busy collapse into the last one, and a pattern that is already showing is
+ * not sent again.
+ */
+class LedManager {
+ public:
+  LedManager() {
+    profiles_[LED_EVENT_READY] = {LED_BREATHING, 250, LED_BLUE, 0};
+    profiles_[LED_EVENT_SCANNING] = {LED_FLASHING, 25, LED_RED, 0};
+    profiles_[LED_EVENT_MATCH] = {LED_ON, 0, LED_PURPLE, 0};
+    // Ring and bad image keep the scanning pattern unless configured otherwise
+    profiles_[LED_EVENT_RING] = {LED_FLASHING, 25, LED_RED, 0};
+    profiles_[LED_EVENT_ERROR] = {LED_FLASHING, 25, LED_RED, 0};
+    profiles_[LED_EVENT_ENROLL_PLACE] = {LED_FLASHING, 25, LED_PURPLE, 0};
+    profiles_[LED_EVENT_ENROLL_LIFT] = {LED_BREATHING, 100, LED_PURPLE, 0};
+    profiles_[LED_EVENT_ENROLL_PASS] = {LED_ON, 0, LED_PURPLE, 0};
+    // Dark while the ESP light-sleeps between touches
+    profiles_[LED_EVENT_SLEEP] = {LED_OFF, 0, LED_BLUE, 0};
+  }
+
+  void set_protocol(SensorProtocol *protocol) { protocol_ = protocol; }
+  void set_profile(LedEvent event, const LedProfile &profile) { profiles_[event] = profile; }
+  // Off for models without the LED ring: requests are dropped and nothing is ever sent
+  void set_enabled(bool enabled) {
+    enabled_ = enabled;
+    pending_ = pending_ && enabled;
+  }
+
+  void request(LedEvent event) {
+    if (!enabled_) {
+      return;
+    }
+    if (pending_) {
+      merged_++;
+    }
+    wanted_ = profiles_[event];
+    pending_ = !shown_valid_ || wanted_ != shown_;
+    if (!pending_) {
+      skipped_++;
+    }
+  }
+
+  bool pending() const { return pending_; }
+
+  // Send the wanted pattern, if it isn't showing yet. Returns the confirmation code.
+  uint8_t flush() {
+    if (!pending_) {
+      return CONFIRM_OK;
+    }
+    pending_ = false;
+    uint8_t result = protocol_->led_control(wanted_.mode, wanted_.speed, wanted_.color, wanted_.count);
+    // Sensors without an LED ring reject the command, don't keep retrying it
+    shown_ = wanted_;
+    shown_valid_ = true;
+    sent_++;
+    return result;
+  }
+
+  // Forget what the LED shows, e.g. after the sensor was power cycled
+  void invalidate() {
+    shown_valid_ = false;
+    pending_ = enabled_;
+  }
+
+  uint32_t sent() const { return sent_; }
+  uint32_t skipped() const { return skipped_; }
+  uint32_t merged() const { return merged_; }
+
+ protected:
+  SensorProtocol *protocol_{nullptr};
+  LedProfile profiles_[LED_EVENT_COUNT];
+  LedProfile wanted_{};
+  LedProfile shown_{};
+  bool shown_valid_ = false;
+  bool pending_ = false;
+  bool enabled_ = true;
+  uint32_t sent_ = 0;
+  uint32_t skipped_ = 0;
+  uint32_t merged_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "sensor_hal.h"
+#include "sensor_protocol.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Export and import of the whole template library as a stream of chunks.
+ *
+ * An export is a sequence of records, each handed to the chunk callback as
+ * (kind, id, index, data, checksum):
+ *   begin         id = capacity, index = number of templates
+ *   name          name of one ID
+ *   <section>     extra state registered with add_section(), e.g. pairing
+ *   template      index-th data packet of the template of ID, base64
+ *   template_end  index = packet count, checksum over the whole template
+ *   end           index = number of templates sent
+ * Every other checksum is FNV-1a over that record's raw data. An import takes
+ * the same records in the same order.
+ *
+ * Template records carry the raw biometric template. Whoever stores a backup
+ * holds everyone's fingerprints; in Home Assistant that includes the
+ * recorder, which keeps every event unless told otherwise. The owner only
+ * exports templates when explicitly asked to.
+ *
+ * Templates move one data packet at a time. An export never holds more than
+ * one packet. An import stages one template in a fixed buffer; the owner
+ * copies it out and writes it later, only if the sensor has something
+ * different in that slot.
+ */
+class LibraryBackup {
+ public:
+  using ChunkCallback = std::function<void(const std::string &kind, int id, int index, const std::string &data,
+                                           uint32_t checksum)>;
+  // Largest template any supported sensor uploads
+  static constexpr uint16_t MAX_TEMPLATE_SIZE = 2048;
+  // Char buffer used for transfers; buffer 1 may hold a scan's template
+  static constexpr uint8_t TRANSFER_BUFFER = 2;
+
+  enum ImportResult : uint8_t {
+    IMPORT_OK,              // Chunk taken
+    IMPORT_TEMPLATE_READY,  // A complete template is staged, take it with staged() and write_template()
+    IMPORT_DONE,            // End record, apply names and sections
+    IMPORT_FAILED,          // Out of order or corrupt, the import was aborted
+  };
+
+  void set_chunk_callback(ChunkCallback &&callback) { callback_ = std::move(callback); }
+
+  void add_section(const char *kind, std::function<std::string()> &&save,
+                   std::function<void(const std::string &)> &&restore) {
+    sections_.push_back({kind, std::move(save), std::move(restore)});
+  }
+
+  // Export side
+
+  void emit(const char *kind, int id, int index, const std::string &data) {
+    emit(kind, id, index, data, blob_checksum(reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+  }
+
+  void emit_sections() {
+    for (auto &section : sections_) {
+      emit(section.kind, 0, 0, section.save());
+    }
+  }
+
+  // Stream the template in `slot` out as the template of `id`
+  uint8_t export_template(SensorProtocol &protocol, uint16_t id, uint16_t slot) {
+    uint8_t result = protocol.load_model(slot, TRANSFER_BUFFER);
+    if (result != CONFIRM_OK) {
+      return result;
+    }
+    uint32_t checksum = BLOB_CHECKSUM_SEED;
+    int index = 0;
+    result = protocol.upload_template(TRANSFER_BUFFER, [&](const uint8_t *data, uint16_t length) {
+      checksum = blob_checksum(data, length, checksum);
+      emit("template", id, index++, base64_encode(data, length), blob_checksum(data, length));
+    });
+    if (result == CONFIRM_OK) {
+      emit("template_end", id, index, "", checksum);
+    }
+    return result;
+  }
+
+  // Import side
+
+  bool importing() const { return importing_; }
+  const std::string &import_error() const { return error_; }
+  uint16_t staged_id() const { return staged_id_; }
+
+  ImportResult import_chunk(const std::string &kind, int id, int index, const std::string &data, uint32_t checksum) {
+    if (kind == "begin") {
+      begin_import();
+      return IMPORT_OK;
+    }
+    if (!importing_) {
+      return fail("Import not started");
+    }
+
+    if (kind == "template") {
+      if (id != staged_id_ && staged_packets_ == 0) {
+        staged_id_ = id;
+        staged_size_ = 0;
+      }
+      if (id != staged_id_ || index != staged_packets_) {
+        return fail("Template packet out of order");
+      }
+      size_t length = base64_decode(data, staging_.get() + staged_size_, MAX_TEMPLATE_SIZE - staged_size_);
+      if (staged_size_ + length > MAX_TEMPLATE_SIZE) {
+        return fail("Template too large");
+      }
+      if (blob_checksum(staging_.get() + staged_size_, length) != checksum) {
+        return fail("Template packet checksum mismatch");
+      }
+      staged_size_ += length;
+      staged_packets_++;
+      return IMPORT_OK;
+    }
+    if (kind == "template_end") {
+      if (id != staged_id_ || index != staged_packets_ || staged_packets_ == 0 ||
+          blob_checksum(staging_.get(), staged_size_) != checksum) {
+        return fail("Template incomplete or corrupt");
+      }
+      staged_packets_ = 0;
+      return IMPORT_TEMPLATE_READY;
+    }
+
+    if (blob_checksum(reinterpret_cast<const uint8_t *>(data.data()), data.size()) != checksum) {
+      return fail("Record checksum mismatch");
+    }
+    if (kind == "name") {
+      names_.emplace_back(id, data);
+      return IMPORT_OK;
+    }
+    if (kind == "end") {
+      return IMPORT_DONE;
+    }
+    for (auto &section : sections_) {
+      if (kind == section.kind) {
+        section_data_.emplace_back(&section, data);
+        return IMPORT_OK;
+      }
+    }
+    ESP_LOGW(TAG, "Skipping unknown backup record '%s'", kind.c_str());
+    return IMPORT_OK;
+  }
+
+  // Copy of the template just completed, the next one is staged over it
+  std::vector<uint8_t> staged() const { return std::vector<uint8_t>(staging_.get(), staging_.get() + staged_size_); }
+
+  /**
+   * Put `data` into `slot`, unless the sensor already has the same template
+   * there. Sets *written to whether the slot was written.
+   */
+  static uint8_t write_template(SensorProtocol &protocol, uint16_t slot, const std::vector<uint8_t> &data,
+                                bool *written) {
+    *written = false;
+    if (protocol.load_model(slot, TRANSFER_BUFFER) == CONFIRM_OK) {
+      uint32_t checksum = BLOB_CHECKSUM_SEED;
+      uint16_t size = 0;
+      uint8_t result = protocol.upload_template(TRANSFER_BUFFER, [&](const uint8_t *data, uint16_t length) {
+        checksum = blob_checksum(data, length, checksum);
+        size += length;
+      });
+      if (result == CONFIRM_OK && size == data.size() && checksum == blob_checksum(data.data(), data.size())) {
+        return CONFIRM_OK;
+      }
+    }
+    uint8_t result = protocol.download_template(TRANSFER_BUFFER, data.data(), data.size());
+    if (result == CONFIRM_OK) {
+      result = protocol.store_model(slot, TRANSFER_BUFFER);
+    }
+    *written = result == CONFIRM_OK;
+    return result;
+  }
+
+  // Names of the import, as (ID, name)
+  const std::vector<std::pair<uint16_t, std::string>> &imported_names() const { return names_; }
+
+  void restore_sections() {
+    for (auto &entry : section_data_) {
+      entry.first->restore(entry.second);
+    }
+  }
+
+  void end_import() {
+    importing_ = false;
+    staging_.reset();
+    names_.clear();
+    names_.shrink_to_fit();
+    section_data_.clear();
+    section_data_.shrink_to_fit();
+  }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_sensor.backup";
+
+  struct Section {
+    const char *kind;
+    std::function<std::string()> save;
+    std::function<void(const std::string &)> restore;
+  };
+
+  void emit(const char *kind, int id, int index, const std::string &data, uint32_t checksum) {
+    if (callback_) {
+      callback_(kind, id, index, data, checksum);
+    }
+  }
+
+  void begin_import() {
+    end_import();
+    staging_.reset(new uint8_t[MAX_TEMPLATE_SIZE]);
+    staged_id_ = 0;
+    staged_size_ = 0;
+    staged_packets_ = 0;
+    error_.clear();
+    importing_ = true;
+  }
+
+  ImportResult fail(const char *error) {
+    ESP_LOGE(TAG, "Import aborted: %s", error);
+    error_ = error;
+    end_import();
+    return IMPORT_FAILED;
+  }
+
+  ChunkCallback callback_;
+  std::vector<Section> sections_;
+
+  bool importing_ = false;
+  std::string error_;
+  std::unique_ptr<uint8_t[]> staging_;
+  uint16_t staged_id_ = 0;
+  uint16_t staged_size_ = 0;
+  int staged_packets_ = 0;
+  std::vector<std::pair<uint16_t, std::string>> names_;
+  std::vector<std::pair<Section *, std::string>> section_data_;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include "esphome/components/text_sensor/text_sensor.h"
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * A whole scan decision as one text sensor state, in JSON:
+ *   {"seq":12,"result":"match","id":3,"name":"Anna","confidence":182,"time":"2026-10-16T09:01:31+0200"}
+ * so a touch is one state update rather than a burst over match_id,
+ * match_name, confidence, ring and status. There is no reset on lift.
+ *
+ * A match or ring goes out right away. A bad image waits for the batching
+ * window, because the retry of the same touch usually brings a decision that
+ * replaces it. seq keeps two decisions for the same finger distinct, and time
+ * is left out until the clock has been set.
+ */
+class MatchEvent {
+ public:
+  void set_sensor(text_sensor::TextSensor *sensor) { sensor_ = sensor; }
+  void set_window(uint32_t window_ms) { window_ms_ = window_ms; }
+#ifdef USE_TIME
+  void set_time(time::RealTimeClock *time) { time_ = time; }
+#endif
+
+  bool enabled() const { return sensor_ != nullptr; }
+
+  // Record a scan outcome. `final` ones are decisions and publish immediately.
+  void add(const char *result, int id, const std::string &name, int confidence, uint32_t now_ms, bool final) {
+    if (sensor_ == nullptr) {
+      return;
+    }
+    if (pending_) {
+      coalesced_++;
+    }
+    result_ = result;
+    id_ = id;
+    name_ = name;
+    confidence_ = confidence;
+    timestamp_ = now();
+    if (!pending_) {
+      pending_ = true;
+      pending_since_ = now_ms;
+    }
+    if (final) {
+      publish();
+    }
+  }
+
+  // Publish a bad image nothing replaced within the window
+  void loop(uint32_t now_ms) {
+    if (pending_ && now_ms - pending_since_ >= window_ms_) {
+      publish();
+    }
+  }
+
+  uint32_t published() const { return seq_; }
+  uint32_t coalesced() const { return coalesced_; }
+
+  // Unix time, 0 until the clock has been set
+  time_t now() const {
+#ifdef USE_TIME
+    if (time_ != nullptr) {
+      ESPTime time = time_->now();
+      if (time.is_valid()) {
+        return time.timestamp;
+      }
+    }
+#endif
+    return 0;
+  }
+
+ protected:
+  void publish() {
+    pending_ = false;
+    char number[16];
+    payload_.assign("{\"seq\":");
+    snprintf(number, sizeof(number), "%u", (unsigned) ++seq_);
+    payload_.append(number).append(",\"result\":\"").append(result_).append("\"");
+    if (id_ >= 0) {
+      snprintf(number, sizeof(number), "%d", id_);
+      payload_.append(",\"id\":").append(number).append(",\"name\":");
+      append_string(name_);
+      snprintf(number, sizeof(number), "%d", confidence_);
+      payload_.append(",\"confidence\":").append(number);
+    }
+#ifdef USE_TIME
+    if (timestamp_ != 0) {
+      payload_.append(",\"time\":\"")
+          .append(ESPTime::from_epoch_local(timestamp_).strftime("%Y-%m-%dT%H:%M:%S%z"))
+          .append("\"");
+    }
+#endif
+    payload_.append("}");
+    sensor_->publish_state(payload_);
+  }
+
+  void append_string(const std::string &value) {
+    payload_.push_back('"');
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        payload_.push_back('\\');
+        payload_.push_back(c);
+      } else if (uint8_t(c) < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        payload_.append(escaped);
+      } else {
+        payload_.push_back(c);
+      }
+    }
+    payload_.push_back('"');
+  }
+
+  text_sensor::TextSensor *sensor_{nullptr};
+#ifdef USE_TIME
+  time::RealTimeClock *time_{nullptr};
+#endif
+  uint32_t window_ms_ = 500;
+  bool pending_ = false;
+  uint32_t pending_since_ = 0;
+  const char *result_ = "";
+  int id_ = -1;
+  std::string name_;
+  int confidence_ = 0;
+  time_t timestamp_ = 0;
+  // Reused so a publish doesn't allocate once it has grown to size
+  std::string payload_;
+  uint32_t seq_ = 0;
+  uint32_t coalesced_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "esphome/core/log.h"
+#include "name_table.h"
+#include "sensor_hal.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Fingerprint names persisted as one versioned blob instead of one entry per ID.
+ *
+ * Layout (little endian):
+ *   magic u32 | version u8 | reserved u8 | slot_count u16 | generation u32 | table_length u32
+ *   slot bitmap, (slot_count + 7) / 8 bytes, bit n set = ID n has a name
+ *   string table, one length-prefixed (u8) name per set bit in ID order
+ *   checksum u32 (FNV-1a over everything before it)
+ *
+ * Updates alternate between two keys and carry an increasing generation, so a
+ * write interrupted by a power cut leaves the previous copy intact.
+ *
+ * Both copies share the NVS partition with every other key (20 kB in the
+ * default ESPHome partition table, part of it reserved for NVS itself), so
+ * in practice a copy stays within a few kB and a full library with long names
+ * fails to save long before the header is the limit. table_length is u32
+ * anyway, so the format doesn't cap larger custom partitions.
+ */
+class NameStore {
+ public:
+  static constexpr uint32_t MAGIC = 0x314D4E46;  // "FNM1"
+  static constexpr uint8_t VERSION = 1;
+  static constexpr size_t HEADER_SIZE = 16;
+  static constexpr size_t CHECKSUM_SIZE = 4;
+  // Per-ID keys written by older firmware, migrated on first boot
+  static constexpr int LEGACY_MAX_ID = 200;
+
+  void set_store(KeyValueStore *store) { store_ = store; }
+
+  bool load(NameTable &names) {
+    names.clear();
+    uint32_t generation_a = 0;
+    uint32_t generation_b = 0;
+    std::vector<uint8_t> blob_a;
+    std::vector<uint8_t> blob_b;
+    bool valid_a = read_copy(KEYS[0], blob_a, &generation_a);
+    bool valid_b = read_copy(KEYS[1], blob_b, &generation_b);
+
+    if (valid_b && (!valid_a || int32_t(generation_b - generation_a) > 0)) {
+      decode(blob_b, names);
+      generation_ = generation_b;
+      active_ = 1;
+    } else if (valid_a) {
+      decode(blob_a, names);
+      generation_ = generation_a;
+      active_ = 0;
+    } else {
+      return migrate_legacy(names);
+    }
+    ESP_LOGD(TAG, "Loaded name table generation %u from %s", generation_, KEYS[active_]);
+    return true;
+  }
+
+  bool save(const NameTable &names) {
+    std::vector<uint8_t> blob;
+    encode(names, generation_ + 1, blob);
+
+    // Never overwrite the copy we would fall back to
+    uint8_t target = active_ ^ 1;
+    if (!store_->put_bytes(KEYS[target], blob.data(), blob.size())) {
+      ESP_LOGE(TAG, "Writing name table to %s failed", KEYS[target]);
+      return false;
+    }
+    active_ = target;
+    generation_++;
+    return true;
+  }
+
+ protected:
+  static constexpr const char *TAG = "fingerprint_sensor.names";
+  static constexpr const char *KEYS[2] = {"names_a", "names_b"};
+
+  static void encode(const NameTable &names, uint32_t generation, std::vector<uint8_t> &out) {
+    uint16_t slot_count = 0;
+    size_t table_length = 0;
+    names.for_each([&](uint16_t id, const char *, uint8_t length) {
+      slot_count = id + 1;
+      table_length += 1 + length;
+    });
+    size_t bitmap_length = (slot_count + 7) / 8;
+
+    out.assign(HEADER_SIZE + bitmap_length + table_length + CHECKSUM_SIZE, 0);
+    uint8_t *header = out.data();
+    put_le32(header, MAGIC);
+    header[4] = VERSION;
+    put_le16(header + 6, slot_count);
+    put_le32(header + 8, generation);
+    put_le32(header + 12, table_length);
+
+    uint8_t *bitmap = header + HEADER_SIZE;
+    uint8_t *table = bitmap + bitmap_length;
+    names.for_each([&](uint16_t id, const char *name, uint8_t length) {
+      bitmap[id / 8] |= 1 << (id % 8);
+      *table++ = length;
+      memcpy(table, name, length);
+      table += length;
+    });
+    put_le32(table, blob_checksum(out.data(), out.size() - CHECKSUM_SIZE));
+  }
+
+  // Reads one copy and checks its framing and checksum
+  bool read_copy(const char *key, std::vector<uint8_t> &blob, uint32_t *generation) {
+    size_t length = store_->get_bytes_length(key);
+    if (length < HEADER_SIZE + CHECKSUM_SIZE) {
+      return false;
+    }
+    blob.resize(length);
+    if (store_->get_bytes(key, blob.data(), length) != length) {
+      return false;
+    }
+
+    const uint8_t *header = blob.data();
+    uint16_t slot_count = get_le16(header + 6);
+    size_t bitmap_length = (slot_count + 7) / 8;
+    size_t table_length = get_le32(header + 12);
+    if (get_le32(header) != MAGIC || header[4] != VERSION ||
+        HEADER_SIZE + bitmap_length + table_length + CHECKSUM_SIZE != length ||
+        get_le32(header + length - CHECKSUM_SIZE) != blob_checksum(header, length - CHECKSUM_SIZE)) {
+      ESP_LOGW(TAG, "Ignoring invalid name table in %s", key);
+      return false;
+    }
+    *generation = get_le32(header + 8);
+    return true;
+  }
+
+  static void decode(const std::vector<uint8_t> &blob, NameTable &names) {
+    uint16_t slot_count = get_le16(&blob[6]);
+    const uint8_t *bitmap = &blob[HEADER_SIZE];
+    const uint8_t *table = bitmap + (slot_count + 7) / 8;
+    const uint8_t *table_end = &blob[blob.size() - CHECKSUM_SIZE];
+    for (uint16_t id = 0; id < slot_count; id++) {
+      if ((bitmap[id / 8] & (1 << (id % 8))) == 0) {
+        continue;
+      }
+      if (table + 1 + *table > table_end) {
+        ESP_LOGW(TAG, "Name table ends early at ID %u", id);
+        return;
+      }
+      if (!names.set(id, reinterpret_cast<const char *>(table + 1), *table)) {
+        ESP_LOGW(TAG, "Dropping name for ID %u, beyond the sensor's capacity", id);
+      }
+      table += 1 + *table;
+    }
+  }
+
+  bool migrate_legacy(NameTable &names) {
+    std::vector<int> migrated;
+    for (int id = 1; id <= LEGACY_MAX_ID; id++) {
+      std::string key = std::to_string(id);
+      if (store_->is_key(key.c_str())) {
+        std::string name = store_->get_string(key.c_str());
+        if (!name.empty() && names.set(id, name)) {
+          migrated.push_back(id);
+        }
+      }
+    }
+    if (migrated.empty()) {
+      return true;
+    }
+
+    ESP_LOGI(TAG, "Migrating %u per-ID names into the name table", (unsigned) migrated.size());
+    if (!save(names)) {
+      // Keep the old entries, we'll try again next boot
+      return false;
+    }
+    for (int id : migrated) {
+      store_->remove(std::to_string(id).c_str());
+    }
+    return true;
+  }
+
+  KeyValueStore *store_{nullptr};
+  uint32_t generation_ = 0;
+  uint8_t active_ = 1;  // So the very first save goes to KEYS[0]
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
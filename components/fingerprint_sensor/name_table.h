@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Fingerprint names indexed by template slot.
+ *
+ * One entry per slot the sensor reports, names packed NUL-terminated into a
+ * single arena. Lookups are an array index and hand out a pointer into the
+ * arena, so the match path never touches the heap. Only set() can allocate,
+ * when the arena is full even after dropping the space of replaced names.
+ */
+class NameTable {
+ public:
+  static constexpr uint8_t MAX_NAME_LENGTH = 255;
+  // Initial arena size, grown on demand by set()
+  static constexpr size_t ARENA_BYTES_PER_SLOT = 12;
+
+  // IDs 0..capacity are valid, the services count from 1
+  void init(uint16_t capacity) {
+    slots_.assign(capacity + 1, Slot{});
+    arena_.assign(size_t(capacity) * ARENA_BYTES_PER_SLOT, 0);
+    arena_used_ = 0;
+    count_ = 0;
+  }
+
+  uint16_t capacity() const { return slots_.empty() ? 0 : slots_.size() - 1; }
+  uint16_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  bool contains(int id) const { return in_range(id) && slots_[id].used; }
+  // NUL-terminated name, nullptr if the slot has none
+  const char *get(int id) const { return contains(id) ? &arena_[slots_[id].offset] : nullptr; }
+  uint8_t length(int id) const { return contains(id) ? slots_[id].length : 0; }
+
+  bool set(int id, const char *name, size_t length) {
+    if (!in_range(id)) {
+      return false;
+    }
+    if (length > MAX_NAME_LENGTH) {
+      length = MAX_NAME_LENGTH;
+    }
+    erase(id);
+    if (arena_used_ + length + 1 > arena_.size()) {
+      compact(length + 1);
+    }
+    memcpy(&arena_[arena_used_], name, length);
+    arena_[arena_used_ + length] = '\0';
+    slots_[id] = Slot{uint32_t(arena_used_), uint8_t(length), true};
+    arena_used_ += length + 1;
+    count_++;
+    return true;
+  }
+  bool set(int id, const std::string &name) { return set(id, name.data(), name.size()); }
+
+  void erase(int id) {
+    if (contains(id)) {
+      slots_[id].used = false;
+      count_--;
+    }
+  }
+
+  void clear() {
+    for (auto &slot : slots_) {
+      slot.used = false;
+    }
+    arena_used_ = 0;
+    count_ = 0;
+  }
+
+  // Calls f(id, name, length) for every named slot in ID order
+  template<typename F> void for_each(F &&f) const {
+    for (uint16_t id = 0; id < slots_.size(); id++) {
+      if (slots_[id].used) {
+        f(id, &arena_[slots_[id].offset], slots_[id].length);
+      }
+    }
+  }
+
+ protected:
+  struct Slot {
+    uint32_t offset = 0;
+    uint8_t length = 0;
+    bool used = false;
+  };
+
+  bool in_range(int id) const { return id >= 0 && size_t(id) < slots_.size(); }
+
+  // Repack live names to the front of a fresh arena with room for `needed` more bytes
+  void compact(size_t needed) {
+    size_t live = 0;
+    for (auto &slot : slots_) {
+      if (slot.used) {
+        live += slot.length + 1;
+      }
+    }
+    size_t size = arena_.size();
+    while (live + needed > size) {
+      size = size == 0 ? 64 : size * 2;
+    }
+
+    std::vector<char> packed(size, 0);
+    size_t used = 0;
+    for (auto &slot : slots_) {
+      if (slot.used) {
+        memcpy(&packed[used], &arena_[slot.offset], slot.length + 1);
+        slot.offset = used;
+        used += slot.length + 1;
+      }
+    }
+    arena_.swap(packed);
+    arena_used_ = used;
+  }
+
+  std::vector<Slot> slots_;
+  std::vector<char> arena_;
+  size_t arena_used_ = 0;
+  uint16_t count_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Which fingerprint IDs hold a template, mirrored from the sensor's index
+ * table at boot and kept current on every store and delete.
+ *
+ * ID 0 is never handed out. The lowest free ID is cached, so next_free() is
+ * a lookup; only taking that very ID rescans, one 32 bit word at a time.
+ */
+class OccupancyMap {
+ public:
+  static constexpr uint16_t NONE = 0xFFFF;
+
+  void init(uint16_t capacity) {
+    capacity_ = capacity;
+    words_.assign((capacity + 31) / 32, 0);
+    count_ = 0;
+    next_free_ = find_free(1);
+  }
+
+  bool test(uint16_t id) const { return id < capacity_ && (words_[id / 32] & (1UL << (id % 32))) != 0; }
+
+  void set(uint16_t id) {
+    if (id == 0 || id >= capacity_ || test(id)) {
+      return;
+    }
+    words_[id / 32] |= 1UL << (id % 32);
+    count_++;
+    if (id == next_free_) {
+      next_free_ = find_free(id + 1);
+    }
+  }
+
+  void clear(uint16_t id) {
+    if (!test(id)) {
+      return;
+    }
+    words_[id / 32] &= ~(1UL << (id % 32));
+    count_--;
+    if (id < next_free_) {
+      next_free_ = id;
+    }
+  }
+
+  void clear_all() { init(capacity_); }
+
+  // Lowest free ID, NONE when the library is full
+  uint16_t next_free() const { return next_free_; }
+  uint16_t count() const { return count_; }
+  uint16_t capacity() const { return capacity_; }
+
+ protected:
+  uint16_t find_free(uint16_t from) const {
+    for (uint16_t word = from / 32; word < words_.size(); word++) {
+      uint32_t free = ~words_[word];
+      if (word == from / 32) {
+        free &= ~0UL << (from % 32);
+      }
+      if (free != 0) {
+        uint16_t id = word * 32 + __builtin_ctz(free);
+        return id < capacity_ ? id : NONE;
+      }
+    }
+    return NONE;
+  }
+
+  std::vector<uint32_t> words_;
+  uint16_t capacity_ = 0;
+  uint16_t count_ = 0;
+  uint16_t next_free_ = NONE;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/components/uart/uart.h"
+#include "sensor_hal.h"
+
+#ifdef USE_ARDUINO
+#include <Preferences.h>
+#endif
+
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Clock backed by the ESPHome HAL (works on the device and on the host platform)
+ */
+class SystemClock : public Clock {
+ public:
+  uint32_t millis() override { return esphome::millis(); }
+  uint32_t micros() override { return esphome::micros(); }
+  void wait_us(uint32_t us) override {
+#ifdef USE_ESP32
+    // The sensor task sleeps while a reply is in flight instead of starving its core
+    if (yield_task_ != nullptr && xTaskGetCurrentTaskHandle() == yield_task_) {
+      vTaskDelay(1);
+      return;
+    }
+#endif
+    esphome::delayMicroseconds(us);
+  }
+
+#ifdef USE_ESP32
+  void set_yield_task(TaskHandle_t task) { yield_task_ = task; }
+
+ protected:
+  TaskHandle_t yield_task_{nullptr};
+#endif
+};
+
+/**
+ * Guards the sensor when a task besides the main loop talks to it.
+ * Usable with std::lock_guard; does nothing until enabled.
+ */
+class SensorLock {
+ public:
+#ifdef USE_ESP32
+  void enable() { mutex_ = xSemaphoreCreateMutex(); }
+  void lock() {
+    if (mutex_ != nullptr) {
+      xSemaphoreTake(mutex_, portMAX_DELAY);
+    }
+  }
+  bool try_lock() { return mutex_ == nullptr || xSemaphoreTake(mutex_, 0) == pdTRUE; }
+  void unlock() {
+    if (mutex_ != nullptr) {
+      xSemaphoreGive(mutex_);
+    }
+  }
+
+ protected:
+  SemaphoreHandle_t mutex_{nullptr};
+#else
+  void lock() {}
+  bool try_lock() { return true; }
+  void unlock() {}
+#endif
+};
+
+/**
+ * Transport over the ESPHome UART bus the component was configured with
+ */
+class UartTransport : public SensorTransport {
+ public:
+  void set_parent(uart::UARTComponent *parent) { parent_ = parent; }
+
+  bool set_baud_rate(uint32_t baud_rate) override {
+    parent_->flush();
+    parent_->set_baud_rate(baud_rate);
+    parent_->load_settings(false);
+    return true;
+  }
+
+  void write(const uint8_t *data, size_t length) override { parent_->write_array(data, length); }
+  int available() override { return parent_->available(); }
+  int read() override {
+    uint8_t byte;
+    return parent_->read_byte(&byte) ? byte : -1;
+  }
+
+ protected:
+  uart::UARTComponent *parent_{nullptr};
+};
+
+#ifdef USE_ARDUINO
+/**
+ * Key/value store in an NVS namespace via Arduino Preferences
+ */
+class PreferencesStore : public KeyValueStore {
+ public:
+  void set_name(const char *name) { name_ = name; }
+
+  bool begin() override { return preferences_.begin(name_, false); }
+  bool is_key(const char *key) override { return preferences_.isKey(key); }
+  std::string get_string(const char *key) override { return preferences_.getString(key, "").c_str(); }
+  bool put_string(const char *key, const std::string &value) override {
+    return preferences_.putString(key, value.c_str()) > 0;
+  }
+  size_t get_bytes_length(const char *key) override { return preferences_.getBytesLength(key); }
+  size_t get_bytes(const char *key, uint8_t *data, size_t max_length) override {
+    return preferences_.getBytes(key, data, max_length);
+  }
+  bool put_bytes(const char *key, const uint8_t *data, size_t length) override {
+    return preferences_.putBytes(key, data, length) == length;
+  }
+  bool remove(const char *key) override { return preferences_.remove(key); }
+  bool clear() override { return preferences_.clear(); }
+
+ protected:
+  const char *name_ = "fingerprints";
+  Preferences preferences_;
+};
+#endif
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include "esphome/core/hal.h"
+#include "sensor_hal.h"
+#include "stage_timing.h"
+
+#ifdef USE_ESP32
+#include <esp_pm.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Light sleep between touches, for doors on a battery or PoE budget.
+ *
+ * Once the reader has been idle for idle_after with its LED off, loop() naps
+ * until the touch ring goes active or max_sleep passes. Every other
+ * component gets a pass between naps. Time asleep, wakeups and the time from
+ * a touch wake to its decision are kept per window: the awake share stands
+ * in for idle current, the wake latency for what sleeping costs in unlock
+ * speed.
+ *
+ * Sleeping is left to ESP-IDF's automatic light sleep, which keeps Wi-Fi
+ * associated through modem sleep and so the API connection up. The reader
+ * holds a lock that keeps the chip awake and only lets go of it for a nap;
+ * the idle task then sleeps between the ring polls. The CPU clock is not
+ * scaled, so the UART keeps its baud rate.
+ */
+class PowerSave {
+ public:
+  void configure(uint32_t idle_after_ms, uint32_t max_sleep_ms) {
+    enabled_ = true;
+    idle_after_ms_ = idle_after_ms;
+    max_sleep_ms_ = max_sleep_ms;
+  }
+  bool enabled() const { return enabled_; }
+  uint32_t idle_after() const { return idle_after_ms_; }
+
+  // Turn on automatic light sleep and stay awake until the first nap. False if ESP-IDF refused.
+  bool begin() {
+#ifdef USE_ESP32
+    esp_pm_config_t config = {};
+    config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    config.min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    config.light_sleep_enable = true;
+    if (esp_pm_configure(&config) != ESP_OK ||
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "fingerprint", &awake_lock_) != ESP_OK) {
+      enabled_ = false;
+      return false;
+    }
+    esp_pm_lock_acquire(awake_lock_);
+#endif
+    return true;
+  }
+
+  // Sleep until the pin is active or max_sleep passes. Returns true if the touch woke us.
+  bool nap(InternalGPIOPin *pin, Clock *clock) {
+    // A touch wake that led to no decision, e.g. a brush of the ring
+    waking_ = false;
+    uint32_t start = clock->micros();
+    bool touched = false;
+#ifdef USE_ESP32
+    esp_pm_lock_release(awake_lock_);
+#endif
+    // The ring is polled rather than armed as a wakeup source, which would
+    // turn its edge interrupt into a level one
+    while (!(touched = pin->digital_read()) && clock->micros() - start < max_sleep_ms_ * 1000) {
+#ifdef USE_ESP32
+      vTaskDelay(pdMS_TO_TICKS(TOUCH_POLL_MS));
+#else
+      clock->wait_us(TOUCH_POLL_MS * 1000);
+#endif
+    }
+#ifdef USE_ESP32
+    esp_pm_lock_acquire(awake_lock_);
+#endif
+    uint32_t now = clock->micros();
+    slept_us_ += now - start;
+    wakeups_++;
+    if (touched) {
+      woke_at_ = now;
+      waking_ = true;
+    }
+    return touched;
+  }
+
+  // A scan decision came in. If a touch wake started it, record how long it took.
+  void decided(uint32_t now_us) {
+    if (waking_) {
+      wake_latency_.record(now_us - woke_at_);
+      waking_ = false;
+    }
+  }
+
+  // Share of the window since the last reset spent awake, in percent
+  float awake_percent(uint32_t now_us) const {
+    uint32_t window = now_us - window_start_;
+    if (window == 0) {
+      return 100.0f;
+    }
+    uint32_t awake = slept_us_ < window ? window - slept_us_ : 0;
+    return 100.0f * awake / window;
+  }
+  uint32_t wakeups() const { return wakeups_; }
+  const LatencyHistogram &wake_latency() const { return wake_latency_; }
+
+  void reset_window(uint32_t now_us) {
+    window_start_ = now_us;
+    slept_us_ = 0;
+    wakeups_ = 0;
+    wake_latency_.reset();
+  }
+
+ protected:
+  // Also the most a touch waits for the nap to notice it
+  static constexpr uint32_t TOUCH_POLL_MS = 20;
+
+  bool enabled_ = false;
+  uint32_t idle_after_ms_ = 5000;
+  uint32_t max_sleep_ms_ = 1000;
+  uint32_t window_start_ = 0;
+  uint32_t slept_us_ = 0;
+  uint32_t wakeups_ = 0;
+  uint32_t woke_at_ = 0;
+  bool waking_ = false;
+  LatencyHistogram wake_latency_;
+#ifdef USE_ESP32
+  esp_pm_lock_handle_t awake_lock_{nullptr};
+#endif
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
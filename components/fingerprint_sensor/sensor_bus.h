@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include "sensor_protocol.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+enum BusPriority : uint8_t {
+  BUS_PRIORITY_HIGH,
+  BUS_PRIORITY_NORMAL,
+  BUS_PRIORITY_LOW,
+  BUS_PRIORITY_COUNT,
+};
+
+// Called with the confirmation code and the full reply packet. On CONFIRM_OK the
+// reply holds all results of the command, see ack_results().
+using BusCallback = std::function<void(uint8_t result, const SensorPacket &reply)>;
+// Several commands that must run back to back, e.g. load and store through a char buffer
+using BusJob = std::function<void(SensorProtocol &protocol)>;
+
+/**
+ * Single point of access to the sensor for everything besides the scan path.
+ *
+ * The scanner and enrollment drive the protocol directly from the owning
+ * component's loop() and always go first. Other users queue their commands
+ * here and the owner runs one of them on each loop pass that left the UART
+ * idle, highest priority first. That keeps frames from different users from
+ * interleaving on the wire and keeps door scans ahead of housekeeping.
+ */
+class SensorBus {
+ public:
+  // Per priority, a full queue rejects new commands
+  static constexpr uint8_t QUEUE_SIZE = 4;
+  static constexpr uint8_t MAX_PARAMS = WriteNotepad::REQUEST;
+
+  void set_protocol(SensorProtocol *protocol) { protocol_ = protocol; }
+  SensorProtocol *get_protocol() { return protocol_; }
+
+  // Queue command C. params holds its C::REQUEST parameter bytes, laid out by its fields.
+  template<typename C>
+  bool submit(BusPriority priority, const uint8_t *params, BusCallback &&callback,
+              uint32_t timeout_ms = SensorProtocol::DEFAULT_TIMEOUT_MS) {
+    static_assert(C::REQUEST <= MAX_PARAMS, "Parameters don't fit in a bus request");
+    Request *request = enqueue(priority);
+    if (request == nullptr) {
+      return false;
+    }
+    request->instruction = C::INSTRUCTION;
+    memcpy(request->params, params, C::REQUEST);
+    request->length = C::REQUEST;
+    request->results = C::RESPONSE;
+    request->idempotent = C::IDEMPOTENT;
+    request->timeout_ms = timeout_ms;
+    request->callback = std::move(callback);
+    request->job = nullptr;
+    return true;
+  }
+
+  // Queue a job that gets the sensor to itself for one pass
+  bool submit_job(BusPriority priority, BusJob &&job) {
+    Request *request = enqueue(priority);
+    if (request == nullptr) {
+      return false;
+    }
+    request->callback = nullptr;
+    request->job = std::move(job);
+    return true;
+  }
+
+  bool pending() const { return depth() > 0; }
+
+  uint8_t depth() const {
+    uint8_t depth = 0;
+    for (auto &queue : queues_) {
+      depth += queue.count;
+    }
+    return depth;
+  }
+
+  // Deepest the queues got since the last call
+  uint8_t take_max_depth() {
+    uint8_t max_depth = max_depth_;
+    max_depth_ = depth();
+    return max_depth;
+  }
+
+  uint32_t rejected() const { return rejected_; }
+
+  // Run the oldest command of the highest non-empty priority. Returns false if there was none.
+  bool run_next() {
+    for (auto &queue : queues_) {
+      if (queue.count == 0) {
+        continue;
+      }
+      // Take it off the queue first, the callback may submit follow-ups
+      Request request = std::move(queue.requests[queue.head]);
+      queue.head = (queue.head + 1) % QUEUE_SIZE;
+      queue.count--;
+
+      if (request.job) {
+        request.job(*protocol_);
+        return true;
+      }
+      uint8_t result = protocol_->command(request.instruction, request.params, request.length, request.results,
+                                          request.timeout_ms, request.idempotent);
+      if (request.callback) {
+        request.callback(result, protocol_->reply());
+      }
+      return true;
+    }
+    return false;
+  }
+
+ protected:
+  struct Request {
+    uint8_t instruction = 0;
+    uint8_t params[MAX_PARAMS];
+    uint8_t length = 0;
+    uint16_t results = 0;
+    bool idempotent = false;
+    uint32_t timeout_ms = 0;
+    BusCallback callback;
+    BusJob job;
+  };
+
+  struct Queue {
+    Request requests[QUEUE_SIZE];
+    uint8_t head = 0;
+    uint8_t count = 0;
+  };
+
+  Request *enqueue(BusPriority priority) {
+    Queue &queue = queues_[priority];
+    if (queue.count == QUEUE_SIZE) {
+      rejected_++;
+      return nullptr;
+    }
+    Request *request = &queue.requests[(queue.head + queue.count) % QUEUE_SIZE];
+    queue.count++;
+    uint8_t depth = this->depth();
+    if (depth > max_depth_) {
+      max_depth_ = depth;
+    }
+    return request;
+  }
+
+  SensorProtocol *protocol_{nullptr};
+  Queue queues_[BUS_PRIORITY_COUNT];
+  uint8_t max_depth_ = 0;
+  uint32_t rejected_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
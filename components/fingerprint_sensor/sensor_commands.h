@@ -0,0 +1,271 @@
+#pragma once
+
+#include <cstdint>
+#include "sensor_packet.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Big-endian field of a command's parameters or results, at a fixed offset
+ */
+template<typename T, uint16_t Offset> struct Field {
+  static constexpr uint16_t OFFSET = Offset;
+  static constexpr uint16_t END = Offset + sizeof(T);
+
+  static constexpr void put(uint8_t *data, T value) {
+    for (uint16_t i = 0; i < sizeof(T); i++) {
+      data[Offset + i] = uint8_t(value >> (8 * (sizeof(T) - 1 - i)));
+    }
+  }
+  static constexpr T get(const uint8_t *data) {
+    T value = 0;
+    for (uint16_t i = 0; i < sizeof(T); i++) {
+      value = T(value << 8) | data[Offset + i];
+    }
+    return value;
+  }
+};
+
+// Opaque bytes, e.g. a notepad page
+template<uint16_t Offset, uint16_t Size> struct Bytes {
+  static constexpr uint16_t OFFSET = Offset;
+  static constexpr uint16_t SIZE = Size;
+  static constexpr uint16_t END = Offset + Size;
+
+  static constexpr uint8_t *at(uint8_t *data) { return data + Offset; }
+  static constexpr const uint8_t *at(const uint8_t *data) { return data + Offset; }
+};
+
+/**
+ * Compile-time layout of one sensor command.
+ *
+ * REQUEST is the number of parameter bytes after the instruction code and
+ * RESPONSE the number of result bytes after the acknowledge's confirmation
+ * code. Each descriptor chains its fields by END, so the sizes follow from
+ * the layout. SensorProtocol encodes parameters straight into its transmit
+ * frame and treats a successful acknowledge shorter than RESPONSE as a
+ * corrupted one, so results can be read in place without length checks.
+ *
+ * IDEMPOTENT commands leave the sensor as they found it when sent twice and
+ * are resent after a corrupted acknowledge. The others already did their
+ * work when the broken reply came back: a second Upload streams the template
+ * again, a second SetSysParam goes out at a baud rate the sensor has left.
+ */
+template<uint8_t Instruction> struct Command {
+  static constexpr uint8_t INSTRUCTION = Instruction;
+  static constexpr uint16_t REQUEST = 0;
+  static constexpr uint16_t RESPONSE = 0;
+  static constexpr bool IDEMPOTENT = false;
+};
+
+struct GetImage : Command<CMD_GET_IMAGE> {
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct Image2Tz : Command<CMD_IMAGE2TZ> {
+  using Slot = Field<uint8_t, 0>;
+  static constexpr uint16_t REQUEST = Slot::END;
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct Search : Command<CMD_SEARCH> {
+  using Slot = Field<uint8_t, 0>;
+  using StartPage = Field<uint16_t, Slot::END>;
+  using PageCount = Field<uint16_t, StartPage::END>;
+  static constexpr uint16_t REQUEST = PageCount::END;
+  using FingerId = Field<uint16_t, 0>;
+  using Confidence = Field<uint16_t, FingerId::END>;
+  static constexpr uint16_t RESPONSE = Confidence::END;
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct RegModel : Command<CMD_REG_MODEL> {};
+
+// Store and Load share their layout: char buffer, then template ID
+template<uint8_t Instruction> struct SlotCommand : Command<Instruction> {
+  using Slot = Field<uint8_t, 0>;
+  using Id = Field<uint16_t, Slot::END>;
+  static constexpr uint16_t REQUEST = Id::END;
+};
+struct Store : SlotCommand<CMD_STORE> {};
+struct Load : SlotCommand<CMD_LOAD> {};
+
+// Followed by data packets, from the sensor for Upload and to it for Download
+struct Upload : Command<CMD_UPLOAD> {
+  using Slot = Field<uint8_t, 0>;
+  static constexpr uint16_t REQUEST = Slot::END;
+};
+struct Download : Command<CMD_DOWNLOAD> {
+  using Slot = Field<uint8_t, 0>;
+  static constexpr uint16_t REQUEST = Slot::END;
+};
+
+struct Delete : Command<CMD_DELETE> {
+  using StartId = Field<uint16_t, 0>;
+  using Count = Field<uint16_t, StartId::END>;
+  static constexpr uint16_t REQUEST = Count::END;
+};
+
+struct Empty : Command<CMD_EMPTY> {};
+
+struct SetSysParam : Command<CMD_SET_SYS_PARAM> {
+  using Register = Field<uint8_t, 0>;
+  using Value = Field<uint8_t, Register::END>;
+  static constexpr uint16_t REQUEST = Value::END;
+};
+
+struct ReadSysParam : Command<CMD_READ_SYS_PARAM> {
+  using StatusReg = Field<uint16_t, 0>;
+  using SystemId = Field<uint16_t, StatusReg::END>;
+  using Capacity = Field<uint16_t, SystemId::END>;
+  using SecurityLevel = Field<uint16_t, Capacity::END>;
+  using Address = Field<uint32_t, SecurityLevel::END>;
+  // 32 << PacketSize bytes per data packet
+  using PacketSize = Field<uint16_t, Address::END>;
+  // In units of 9600 baud
+  using BaudRate = Field<uint16_t, PacketSize::END>;
+  static constexpr uint16_t RESPONSE = BaudRate::END;
+};
+
+struct VerifyPassword : Command<CMD_VERIFY_PASSWORD> {
+  using Password = Field<uint32_t, 0>;
+  static constexpr uint16_t REQUEST = Password::END;
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct WriteNotepad : Command<CMD_WRITE_NOTEPAD> {
+  using Page = Field<uint8_t, 0>;
+  using Data = Bytes<Page::END, NOTEPAD_PAGE_SIZE>;
+  static constexpr uint16_t REQUEST = Data::END;
+};
+
+struct ReadNotepad : Command<CMD_READ_NOTEPAD> {
+  using Page = Field<uint8_t, 0>;
+  static constexpr uint16_t REQUEST = Page::END;
+  using Data = Bytes<0, NOTEPAD_PAGE_SIZE>;
+  static constexpr uint16_t RESPONSE = Data::END;
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct TemplateCount : Command<CMD_TEMPLATE_COUNT> {
+  using Count = Field<uint16_t, 0>;
+  static constexpr uint16_t RESPONSE = Count::END;
+};
+
+struct ReadIndexTable : Command<CMD_READ_INDEX_TABLE> {
+  using Page = Field<uint8_t, 0>;
+  static constexpr uint16_t REQUEST = Page::END;
+  using Bitmap = Bytes<0, INDEX_TABLE_PAGE_SIZE>;
+  static constexpr uint16_t RESPONSE = Bitmap::END;
+  static constexpr bool IDEMPOTENT = true;
+};
+
+struct AuraLedConfig : Command<CMD_AURA_LED_CONFIG> {
+  using Mode = Field<uint8_t, 0>;
+  using Speed = Field<uint8_t, Mode::END>;
+  using Color = Field<uint8_t, Speed::END>;
+  using Count = Field<uint8_t, Color::END>;
+  static constexpr uint16_t REQUEST = Count::END;
+};
+
+/**
+ * The one buffer commands are encoded in. Parameters are written in place
+ * behind the instruction code, then seal() adds header and checksum around
+ * them, so the frame goes out (and is resent) without a copy.
+ */
+class CommandFrame {
+ public:
+  static constexpr uint16_t CAPACITY = PACKET_HEADER_SIZE + PACKET_MAX_PAYLOAD + 2;
+  static constexpr uint16_t MAX_PARAMS = PACKET_MAX_PAYLOAD - 1;
+
+  constexpr uint8_t *params() { return bytes_ + PACKET_HEADER_SIZE + 1; }
+
+  template<typename C> constexpr void seal(uint32_t address) {
+    static_assert(C::REQUEST <= MAX_PARAMS, "Parameters don't fit in one packet");
+    static_assert(1 + C::RESPONSE <= PACKET_MAX_PAYLOAD, "Results don't fit in one packet");
+    seal(address, C::INSTRUCTION, C::REQUEST);
+  }
+  // For commands only known at runtime, e.g. queued on the SensorBus
+  constexpr void seal(uint32_t address, uint8_t instruction, uint16_t param_length) {
+    bytes_[PACKET_HEADER_SIZE] = instruction;
+    size_ = seal_packet(address, PACKET_COMMAND, 1 + param_length, bytes_);
+  }
+
+  constexpr uint8_t instruction() const { return bytes_[PACKET_HEADER_SIZE]; }
+  constexpr const uint8_t *data() const { return bytes_; }
+  constexpr uint16_t size() const { return size_; }
+
+ protected:
+  uint8_t bytes_[CAPACITY] = {};
+  uint16_t size_ = 0;
+};
+
+// Results of an acknowledge, behind its confirmation code
+inline const uint8_t *ack_results(const SensorPacket &ack) { return ack.data + 1; }
+
+/**
+ * Reference frames from the R503 manual (default address, password 0),
+ * checked against the descriptors at compile time
+ */
+namespace reference_frames {
+
+constexpr uint8_t GET_IMAGE[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x03, 0x01, 0x00, 0x05};
+constexpr uint8_t VERIFY_PASSWORD[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00,
+                                       0x07, 0x13, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1B};
+// Buffer 1 against templates 0..199
+constexpr uint8_t SEARCH[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0x00, 0x08,
+                              0x04, 0x01, 0x00, 0x00, 0x00, 0xC8, 0x00, 0xD6};
+// Match on template 5 with score 200
+constexpr uint8_t SEARCH_ACK[] = {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00,
+                                  0x07, 0x00, 0x00, 0x05, 0x00, 0xC8, 0x00, 0xDB};
+
+template<size_t N> constexpr bool equals(const CommandFrame &frame, const uint8_t (&expected)[N]) {
+  if (frame.size() != N) {
+    return false;
+  }
+  for (size_t i = 0; i < N; i++) {
+    if (frame.data()[i] != expected[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(
+    [] {
+      CommandFrame frame;
+      frame.seal<GetImage>(0xFFFFFFFF);
+      return equals(frame, GET_IMAGE);
+    }(),
+    "GetImage does not encode to the reference frame");
+static_assert(
+    [] {
+      CommandFrame frame;
+      VerifyPassword::Password::put(frame.params(), 0);
+      frame.seal<VerifyPassword>(0xFFFFFFFF);
+      return equals(frame, VERIFY_PASSWORD);
+    }(),
+    "VerifyPassword does not encode to the reference frame");
+static_assert(
+    [] {
+      CommandFrame frame;
+      Search::Slot::put(frame.params(), 1);
+      Search::StartPage::put(frame.params(), 0);
+      Search::PageCount::put(frame.params(), 200);
+      frame.seal<Search>(0xFFFFFFFF);
+      return equals(frame, SEARCH);
+    }(),
+    "Search does not encode to the reference frame");
+static_assert(check_packet(SEARCH_ACK, sizeof(SEARCH_ACK), PACKET_ACK) &&
+                  sizeof(SEARCH_ACK) - PACKET_HEADER_SIZE - 2 == 1 + Search::RESPONSE &&
+                  Search::FingerId::get(SEARCH_ACK + PACKET_HEADER_SIZE + 1) == 5 &&
+                  Search::Confidence::get(SEARCH_ACK + PACKET_HEADER_SIZE + 1) == 200,
+              "Search acknowledge does not decode like the reference frame");
+static_assert(!check_packet(SEARCH, sizeof(SEARCH), PACKET_ACK) && check_packet(SEARCH, sizeof(SEARCH), PACKET_COMMAND),
+              "check_packet must tell commands from acknowledges");
+
+}  // namespace reference_frames
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
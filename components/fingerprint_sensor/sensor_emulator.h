@@ -0,0 +1,489 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "sensor_hal.h"
+#include "sensor_commands.h"
+#include "sensor_protocol.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Clock that only moves when told to. Waiting on it advances time instantly,
+ * so emulated round trips cost no wall time but still add up correctly.
+ */
+class VirtualClock : public Clock {
+ public:
+  uint32_t millis() override { return now_us_ / 1000; }
+  uint32_t micros() override { return now_us_; }
+  void wait_us(uint32_t us) override { now_us_ += us; }
+  void advance_ms(uint32_t ms) { now_us_ += uint64_t(ms) * 1000; }
+
+ protected:
+  uint64_t now_us_ = 0;
+};
+
+/**
+ * Key/value store kept in RAM
+ */
+class MemoryStore : public KeyValueStore {
+ public:
+  bool is_key(const char *key) override { return values_.count(key) > 0; }
+  std::string get_string(const char *key) override {
+    auto it = values_.find(key);
+    return it == values_.end() ? "" : it->second;
+  }
+  bool put_string(const char *key, const std::string &value) override {
+    values_[key] = value;
+    return true;
+  }
+  size_t get_bytes_length(const char *key) override {
+    auto it = values_.find(key);
+    return it == values_.end() ? 0 : it->second.size();
+  }
+  size_t get_bytes(const char *key, uint8_t *data, size_t max_length) override {
+    auto it = values_.find(key);
+    if (it == values_.end() || it->second.size() > max_length) return 0;
+    memcpy(data, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+  bool put_bytes(const char *key, const uint8_t *data, size_t length) override {
+    values_[key] = std::string(reinterpret_cast<const char *>(data), length);
+    return true;
+  }
+  bool remove(const char *key) override { return values_.erase(key) > 0; }
+  bool clear() override {
+    values_.clear();
+    return true;
+  }
+
+ protected:
+  std::map<std::string, std::string> values_;
+};
+
+/**
+ * Per-command processing times of the emulated sensor, in milliseconds.
+ * Defaults are in the range measured on an R503; UART time is added on top.
+ */
+struct EmulatorTiming {
+  uint32_t get_image_ms = 60;
+  uint32_t no_finger_ms = 8;
+  uint32_t image2tz_ms = 110;
+  uint32_t search_base_ms = 12;
+  uint32_t search_per_template_us = 150;
+  uint32_t reg_model_ms = 45;
+  uint32_t store_ms = 40;
+  uint32_t led_ms = 4;
+  uint32_t default_ms = 5;
+};
+
+/**
+ * R503/AS608 emulator speaking the real packet protocol.
+ *
+ * Fingers are identified by a non-zero token: an image of token N converts
+ * into a template of N, and a stored template matches any image of the same
+ * token. Responses become readable once the command's processing time plus
+ * the UART transfer time has passed on the attached clock.
+ */
+class SensorEmulator : public SensorTransport {
+ public:
+  static constexpr uint8_t CHAR_BUFFERS = 6;
+  static constexpr uint8_t NOTEPAD_PAGES = 16;
+  // Size of an uploaded template and of its data packets
+  static constexpr uint16_t TEMPLATE_SIZE = 512;
+  static constexpr uint16_t DATA_PACKET_SIZE = 128;
+
+  explicit SensorEmulator(uint16_t capacity = 200) : library_(capacity, 0) {}
+
+  void set_clock(Clock *clock) { clock_ = clock; }
+  void set_timing(const EmulatorTiming &timing) { timing_ = timing; }
+  void set_get_image_time(uint32_t ms) { timing_.get_image_ms = ms; }
+  void set_image2tz_time(uint32_t ms) { timing_.image2tz_ms = ms; }
+  void set_search_time(uint32_t ms) { timing_.search_base_ms = ms; }
+  void set_store_time(uint32_t ms) { timing_.store_ms = ms; }
+  // Rate the emulated sensor listens on; SetSysPara changes it like on the real one
+  void set_sensor_baud_rate(uint32_t baud_rate) { baud_rate_ = baud_rate; }
+  uint32_t sensor_baud_rate() const { return baud_rate_; }
+  // Replies at faster rates always arrive corrupted, like over a long cable
+  void set_max_reliable_baud_rate(uint32_t baud_rate) { max_reliable_baud_rate_ = baud_rate; }
+  // Host side. With the two sides at different rates nothing gets through.
+  bool set_baud_rate(uint32_t baud_rate) override {
+    host_baud_rate_ = baud_rate;
+    parser_.reset();
+    return true;
+  }
+  // Probability of a response getting lost or arriving with a bad checksum
+  void set_error_rate(float rate) { error_rate_ = rate; }
+  // Probability of image2Tz() rejecting an otherwise good image
+  void set_bad_image_rate(float rate) { bad_image_rate_ = rate; }
+  // Probability of image2Tz() turning a poor image into a template that matches nothing
+  void set_false_reject_rate(float rate) { false_reject_rate_ = rate; }
+  void set_seed(uint32_t seed) { rng_state_ = seed != 0 ? seed : 1; }
+  // An unpowered sensor ignores everything sent to it, like an unplugged one
+  void set_powered(bool powered) {
+    powered_ = powered;
+    if (!powered) {
+      tx_.clear();
+      parser_.reset();
+    }
+  }
+
+  // Finger placed on / removed from the sensor window
+  void place_finger(uint16_t token) { finger_ = token; }
+  void lift_finger() { finger_ = 0; }
+  uint16_t finger() const { return finger_; }
+
+  // Pre-populate the library without going through enrollment
+  void store_template(uint16_t page, uint16_t token) {
+    if (page < library_.size()) library_[page] = token;
+  }
+  uint16_t capacity() const { return library_.size(); }
+  uint32_t commands_handled() const { return commands_handled_; }
+
+  void write(const uint8_t *data, size_t length) override {
+    if (!powered_ || host_baud_rate_ != baud_rate_) return;
+    for (size_t i = 0; i < length; i++) {
+      switch (parser_.feed(data[i], &request_)) {
+        case PacketParser::COMPLETE:
+          handle_packet(length);
+          break;
+        case PacketParser::BAD_FRAME:
+          respond(CONFIRM_PACKET_RECEIVE_ERR, nullptr, 0, timing_.default_ms, length);
+          break;
+        case PacketParser::NEED_MORE:
+          break;
+      }
+    }
+  }
+
+  int available() override {
+    if (tx_.empty() || now_us() < ready_at_us_) return 0;
+    return tx_.size();
+  }
+
+  int read() override {
+    if (available() <= 0) return -1;
+    uint8_t byte = tx_.front();
+    tx_.pop_front();
+    return byte;
+  }
+
+ protected:
+  // Token of a template from a poor image, no enrolled finger has it
+  static constexpr uint16_t POOR_TEMPLATE = 0xFFFF;
+
+  uint64_t now_us() {
+    // Track wrap-around of the 32 bit clock so long runs keep their order
+    uint32_t now = clock_->micros();
+    if (now < last_micros_) epoch_us_ += uint64_t(1) << 32;
+    last_micros_ = now;
+    return epoch_us_ + now;
+  }
+
+  uint32_t uart_time_us(size_t bytes) const { return uint64_t(bytes) * 10 * 1000000 / baud_rate_; }
+
+  bool chance(float probability) {
+    if (probability <= 0.0f) return false;
+    // xorshift32, good enough for error injection and reproducible per seed
+    rng_state_ ^= rng_state_ << 13;
+    rng_state_ ^= rng_state_ >> 17;
+    rng_state_ ^= rng_state_ << 5;
+    return (rng_state_ & 0xFFFFFF) < probability * 0x1000000;
+  }
+
+  void handle_packet(size_t request_bytes) {
+    if (download_slot_ != 0 && (request_.type == PACKET_DATA || request_.type == PACKET_END_DATA)) {
+      receive_data();
+      return;
+    }
+    commands_handled_++;
+    if (request_.type != PACKET_COMMAND || request_.length < 1) {
+      respond(CONFIRM_PACKET_RECEIVE_ERR, nullptr, 0, timing_.default_ms, request_bytes);
+      return;
+    }
+    const uint8_t *params = request_.data + 1;
+    uint16_t param_length = request_.length - 1;
+    uint8_t out[1 + NOTEPAD_PAGE_SIZE];
+
+    switch (request_.data[0]) {
+      case CMD_VERIFY_PASSWORD:
+      case CMD_AURA_LED_CONFIG:
+        respond(CONFIRM_OK, nullptr, 0, timing_.led_ms, request_bytes);
+        return;
+
+      case CMD_READ_SYS_PARAM: {
+        uint8_t sys[ReadSysParam::RESPONSE] = {0};
+        ReadSysParam::Capacity::put(sys, library_.size());
+        ReadSysParam::SecurityLevel::put(sys, 3);
+        ReadSysParam::Address::put(sys, 0xFFFFFFFF);
+        ReadSysParam::PacketSize::put(sys, 2);  // 128 byte data packets
+        ReadSysParam::BaudRate::put(sys, baud_rate_ / 9600);
+        respond(CONFIRM_OK, sys, sizeof(sys), timing_.default_ms, request_bytes);
+        return;
+      }
+
+      case CMD_SET_SYS_PARAM: {
+        uint8_t rate = param_length >= SetSysParam::REQUEST ? SetSysParam::Value::get(params) : 0;
+        if (rate < 1 || rate > 12 || SetSysParam::Register::get(params) != SYS_PARAM_BAUD_RATE) {
+          respond(CONFIRM_INVALID_REG, nullptr, 0, timing_.default_ms, request_bytes);
+        } else {
+          // Acknowledged at the old rate, the new one applies from the next command
+          respond(CONFIRM_OK, nullptr, 0, timing_.store_ms, request_bytes);
+          baud_rate_ = rate * 9600;
+        }
+        return;
+      }
+
+      case CMD_GET_IMAGE:
+        if (finger_ == 0) {
+          image_ = 0;
+          respond(CONFIRM_NO_FINGER, nullptr, 0, timing_.no_finger_ms, request_bytes);
+        } else {
+          image_ = finger_;
+          respond(CONFIRM_OK, nullptr, 0, timing_.get_image_ms, request_bytes);
+        }
+        return;
+
+      case CMD_IMAGE2TZ: {
+        uint8_t slot = param_length >= 1 ? params[0] : 1;
+        if (slot < 1 || slot > CHAR_BUFFERS) {
+          respond(CONFIRM_INVALID_REG, nullptr, 0, timing_.default_ms, request_bytes);
+        } else if (image_ == 0) {
+          respond(CONFIRM_INVALID_IMAGE, nullptr, 0, timing_.image2tz_ms, request_bytes);
+        } else if (chance(bad_image_rate_)) {
+          respond(CONFIRM_IMAGE_MESS, nullptr, 0, timing_.image2tz_ms, request_bytes);
+        } else {
+          char_buffers_[slot - 1] = chance(false_reject_rate_) ? POOR_TEMPLATE : image_;
+          respond(CONFIRM_OK, nullptr, 0, timing_.image2tz_ms, request_bytes);
+        }
+        return;
+      }
+
+      case CMD_SEARCH: {
+        if (param_length < Search::REQUEST) break;
+        uint8_t slot = Search::Slot::get(params);
+        uint16_t start = Search::StartPage::get(params);
+        uint16_t count = Search::PageCount::get(params);
+        uint16_t token = slot >= 1 && slot <= CHAR_BUFFERS ? char_buffers_[slot - 1] : 0;
+        uint16_t end = start + count < library_.size() ? start + count : library_.size();
+        uint32_t search_ms = timing_.search_base_ms + (uint32_t(end > start ? end - start : 0) *
+                                                       timing_.search_per_template_us) / 1000;
+        for (uint16_t page = start; token != 0 && page < end; page++) {
+          if (library_[page] == token) {
+            uint8_t hit[Search::RESPONSE];
+            Search::FingerId::put(hit, page);
+            Search::Confidence::put(hit, 100 + (token * 37) % 150);  // Stable per finger
+            respond(CONFIRM_OK, hit, sizeof(hit), search_ms, request_bytes);
+            return;
+          }
+        }
+        respond(CONFIRM_NOT_FOUND, nullptr, 0, search_ms, request_bytes);
+        return;
+      }
+
+      case CMD_REG_MODEL: {
+        // All filled buffers must come from the same finger
+        uint16_t token = char_buffers_[0];
+        bool match = token != 0;
+        for (uint8_t i = 1; i < CHAR_BUFFERS; i++) {
+          if (char_buffers_[i] != 0 && char_buffers_[i] != token) match = false;
+        }
+        respond(match ? CONFIRM_OK : CONFIRM_ENROLL_MISMATCH, nullptr, 0, timing_.reg_model_ms, request_bytes);
+        return;
+      }
+
+      case CMD_STORE:
+      case CMD_LOAD: {
+        if (param_length < Store::REQUEST) break;
+        uint8_t slot = Store::Slot::get(params);
+        uint16_t page = Store::Id::get(params);
+        if (slot < 1 || slot > CHAR_BUFFERS || page >= library_.size()) {
+          respond(CONFIRM_BAD_LOCATION, nullptr, 0, timing_.default_ms, request_bytes);
+        } else if (request_.data[0] == CMD_STORE) {
+          library_[page] = char_buffers_[slot - 1];
+          respond(CONFIRM_OK, nullptr, 0, timing_.store_ms, request_bytes);
+        } else {
+          char_buffers_[slot - 1] = library_[page];
+          respond(library_[page] != 0 ? CONFIRM_OK : CONFIRM_DB_READ_FAIL, nullptr, 0, timing_.default_ms,
+                  request_bytes);
+        }
+        return;
+      }
+
+      case CMD_UPLOAD: {
+        uint8_t slot = param_length >= 1 ? params[0] : 0;
+        if (slot < 1 || slot > CHAR_BUFFERS || char_buffers_[slot - 1] == 0) {
+          respond(CONFIRM_UPLOAD_FEATURE_FAIL, nullptr, 0, timing_.default_ms, request_bytes);
+          return;
+        }
+        respond(CONFIRM_OK, nullptr, 0, timing_.default_ms, request_bytes);
+        uint8_t data[TEMPLATE_SIZE];
+        encode_template(char_buffers_[slot - 1], data);
+        for (uint16_t offset = 0; offset < TEMPLATE_SIZE; offset += DATA_PACKET_SIZE) {
+          send_data(offset + DATA_PACKET_SIZE < TEMPLATE_SIZE ? PACKET_DATA : PACKET_END_DATA, data + offset,
+                    DATA_PACKET_SIZE);
+        }
+        return;
+      }
+
+      case CMD_DOWNLOAD: {
+        uint8_t slot = param_length >= 1 ? params[0] : 0;
+        if (slot < 1 || slot > CHAR_BUFFERS) {
+          respond(CONFIRM_INVALID_REG, nullptr, 0, timing_.default_ms, request_bytes);
+          return;
+        }
+        // The data packets that follow are not acknowledged
+        download_slot_ = slot;
+        download_.clear();
+        respond(CONFIRM_OK, nullptr, 0, timing_.default_ms, request_bytes);
+        return;
+      }
+
+      case CMD_DELETE: {
+        if (param_length < Delete::REQUEST) break;
+        uint16_t page = Delete::StartId::get(params);
+        uint16_t count = Delete::Count::get(params);
+        if (page + count > library_.size()) {
+          respond(CONFIRM_BAD_LOCATION, nullptr, 0, timing_.default_ms, request_bytes);
+          return;
+        }
+        for (uint16_t i = 0; i < count; i++) library_[page + i] = 0;
+        respond(CONFIRM_OK, nullptr, 0, timing_.store_ms, request_bytes);
+        return;
+      }
+
+      case CMD_EMPTY:
+        for (auto &entry : library_) entry = 0;
+        respond(CONFIRM_OK, nullptr, 0, timing_.store_ms, request_bytes);
+        return;
+
+      case CMD_TEMPLATE_COUNT: {
+        uint16_t count = 0;
+        for (auto entry : library_) count += entry != 0;
+        TemplateCount::Count::put(out, count);
+        respond(CONFIRM_OK, out, TemplateCount::RESPONSE, timing_.default_ms, request_bytes);
+        return;
+      }
+
+      case CMD_WRITE_NOTEPAD:
+        if (param_length < WriteNotepad::REQUEST || WriteNotepad::Page::get(params) >= NOTEPAD_PAGES) break;
+        memcpy(notepad_[params[0]], WriteNotepad::Data::at(params), WriteNotepad::Data::SIZE);
+        respond(CONFIRM_OK, nullptr, 0, timing_.store_ms, request_bytes);
+        return;
+
+      case CMD_READ_NOTEPAD:
+        if (param_length < 1 || params[0] >= NOTEPAD_PAGES) break;
+        respond(CONFIRM_OK, notepad_[params[0]], NOTEPAD_PAGE_SIZE, timing_.default_ms, request_bytes);
+        return;
+
+      case CMD_READ_INDEX_TABLE: {
+        if (param_length < 1) break;
+        memset(out, 0, INDEX_TABLE_PAGE_SIZE);
+        uint32_t base = uint32_t(params[0]) * INDEX_TABLE_PAGE_SIZE * 8;
+        for (uint16_t bit = 0; bit < INDEX_TABLE_PAGE_SIZE * 8; bit++) {
+          if (base + bit < library_.size() && library_[base + bit] != 0) {
+            out[bit / 8] |= 1 << (bit % 8);
+          }
+        }
+        respond(CONFIRM_OK, out, INDEX_TABLE_PAGE_SIZE, timing_.default_ms, request_bytes);
+        return;
+      }
+
+      default:
+        break;
+    }
+    respond(CONFIRM_PACKET_RECEIVE_ERR, nullptr, 0, timing_.default_ms, request_bytes);
+  }
+
+  void respond(uint8_t confirm, const uint8_t *data, uint16_t length, uint32_t processing_ms,
+               size_t request_bytes) {
+    uint8_t payload[1 + PACKET_MAX_PAYLOAD];
+    payload[0] = confirm;
+    if (length > 0) memcpy(payload + 1, data, length);
+    uint8_t frame[PACKET_HEADER_SIZE + PACKET_MAX_PAYLOAD + 3];
+    size_t size = encode_packet(0xFFFFFFFF, PACKET_ACK, payload, length + 1, frame);
+
+    ready_at_us_ = now_us() + uart_time_us(request_bytes + size) + uint64_t(processing_ms) * 1000;
+    if (baud_rate_ > max_reliable_baud_rate_) {
+      frame[size - 1] ^= 0x5A;
+    } else if (chance(error_rate_)) {
+      // Half of the injected faults lose the response, the other half corrupt it
+      if (chance(0.5f)) return;
+      frame[size - 1] ^= 0x5A;
+    }
+    tx_.insert(tx_.end(), frame, frame + size);
+  }
+
+  // Data packet from the sensor, readable after the ones queued before it
+  void send_data(uint8_t type, const uint8_t *data, uint16_t length) {
+    uint8_t frame[PACKET_HEADER_SIZE + PACKET_MAX_PAYLOAD + 2];
+    size_t size = encode_packet(0xFFFFFFFF, type, data, length, frame);
+    ready_at_us_ += uart_time_us(size);
+    tx_.insert(tx_.end(), frame, frame + size);
+  }
+
+  void receive_data() {
+    download_.insert(download_.end(), request_.data, request_.data + request_.length);
+    if (request_.type != PACKET_END_DATA) {
+      return;
+    }
+    char_buffers_[download_slot_ - 1] = decode_template(download_.data(), download_.size());
+    download_slot_ = 0;
+    download_.clear();
+  }
+
+  // A template is the finger token followed by filler derived from it
+  static void encode_template(uint16_t token, uint8_t *data) {
+    put_u16(data, token);
+    for (uint16_t i = 2; i < TEMPLATE_SIZE; i++) {
+      data[i] = uint8_t(token * 31 + i);
+    }
+  }
+
+  // Token of a downloaded template, 0 if it is not one we produced
+  static uint16_t decode_template(const uint8_t *data, size_t length) {
+    if (length != TEMPLATE_SIZE) return 0;
+    uint8_t expected[TEMPLATE_SIZE];
+    encode_template(get_u16(data), expected);
+    return memcmp(data, expected, TEMPLATE_SIZE) == 0 ? get_u16(data) : 0;
+  }
+
+  static uint16_t get_u16(const uint8_t *data) { return (data[0] << 8) | data[1]; }
+  static void put_u16(uint8_t *data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value;
+  }
+
+  Clock *clock_{nullptr};
+  EmulatorTiming timing_;
+  uint32_t baud_rate_ = 57600;
+  uint32_t host_baud_rate_ = 57600;
+  uint32_t max_reliable_baud_rate_ = UINT32_MAX;
+  float error_rate_ = 0.0f;
+  float bad_image_rate_ = 0.0f;
+  float false_reject_rate_ = 0.0f;
+  uint32_t rng_state_ = 0x2545F491;
+  bool powered_ = true;
+
+  PacketParser parser_;
+  SensorPacket request_;
+  std::deque<uint8_t> tx_;
+  uint64_t ready_at_us_ = 0;
+  uint64_t epoch_us_ = 0;
+  uint32_t last_micros_ = 0;
+  uint32_t commands_handled_ = 0;
+
+  uint16_t finger_ = 0;
+  uint16_t image_ = 0;
+  uint16_t char_buffers_[CHAR_BUFFERS] = {0};
+  uint8_t download_slot_ = 0;
+  std::vector<uint8_t> download_;
+  std::vector<uint16_t> library_;
+  uint8_t notepad_[NOTEPAD_PAGES][NOTEPAD_PAGE_SIZE] = {{0}};
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
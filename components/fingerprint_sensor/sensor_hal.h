@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Byte stream to the fingerprint sensor.
+ * On the device this is the UART, on a host it is the emulator.
+ */
+class SensorTransport {
+ public:
+  virtual ~SensorTransport() = default;
+
+  virtual void write(const uint8_t *data, size_t length) = 0;
+  // Number of bytes that can be read without waiting
+  virtual int available() = 0;
+  // Next received byte, or -1 if none is available
+  virtual int read() = 0;
+  // Switch the host side of the link. Returns false if the transport can't.
+  virtual bool set_baud_rate(uint32_t /*baud_rate*/) { return false; }
+};
+
+/**
+ * Time source for scheduling and round-trip timeouts.
+ */
+class Clock {
+ public:
+  virtual ~Clock() = default;
+
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+  // Short busy wait used while a response is in flight
+  virtual void wait_us(uint32_t us) = 0;
+};
+
+/**
+ * Persistent key/value storage for fingerprint names.
+ */
+class KeyValueStore {
+ public:
+  virtual ~KeyValueStore() = default;
+
+  virtual bool begin() { return true; }
+  virtual bool is_key(const char *key) = 0;
+  virtual std::string get_string(const char *key) = 0;
+  virtual bool put_string(const char *key, const std::string &value) = 0;
+  // Binary values. get_bytes() returns the number of bytes copied, 0 if the key is missing.
+  virtual size_t get_bytes_length(const char *key) = 0;
+  virtual size_t get_bytes(const char *key, uint8_t *data, size_t max_length) = 0;
+  virtual bool put_bytes(const char *key, const uint8_t *data, size_t length) = 0;
+  virtual bool remove(const char *key) = 0;
+  virtual bool clear() = 0;
+};
+
+// Little endian fields and FNV-1a checksums for the blobs kept in a KeyValueStore
+inline void put_le16(uint8_t *out, uint16_t value) {
+  out[0] = value;
+  out[1] = value >> 8;
+}
+inline void put_le32(uint8_t *out, uint32_t value) {
+  put_le16(out, value);
+  put_le16(out + 2, value >> 16);
+}
+inline uint16_t get_le16(const uint8_t *in) { return in[0] | (in[1] << 8); }
+inline uint32_t get_le32(const uint8_t *in) { return get_le16(in) | (uint32_t(get_le16(in + 2)) << 16); }
+
+static constexpr uint32_t BLOB_CHECKSUM_SEED = 2166136261UL;
+
+// Pass the previous result as hash to continue a checksum over several pieces
+inline uint32_t blob_checksum(const uint8_t *data, size_t length, uint32_t hash = BLOB_CHECKSUM_SEED) {
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
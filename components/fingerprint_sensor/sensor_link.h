@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Decides when to look for the sensor while it isn't answering.
+ *
+ * Probes go out from loop() with exponential backoff between MIN_RETRY_MS
+ * and MAX_RETRY_MS. A sensor that is unplugged or still powering up costs one
+ * short verifyPassword() now and then instead of holding up boot. Once
+ * connected, the sensor counts as lost after LOST_AFTER commands in a row got
+ * no reply at all, and probing starts over.
+ */
+class SensorLink {
+ public:
+  static constexpr uint32_t MIN_RETRY_MS = 250;
+  static constexpr uint32_t MAX_RETRY_MS = 30000;
+  // A present sensor answers verifyPassword() within a few ms
+  static constexpr uint32_t PROBE_TIMEOUT_MS = 100;
+  static constexpr uint8_t LOST_AFTER = 3;
+
+  // The first probe is due right away
+  bool probe_due(uint32_t now) const { return now - last_probe_ >= retry_ms_; }
+
+  void probe_failed(uint32_t now) {
+    last_probe_ = now;
+    retry_ms_ = retry_ms_ < MIN_RETRY_MS ? MIN_RETRY_MS : retry_ms_ * 2;
+    if (retry_ms_ > MAX_RETRY_MS) {
+      retry_ms_ = MAX_RETRY_MS;
+    }
+    failed_probes_++;
+  }
+
+  void connected() {
+    retry_ms_ = 0;
+    failed_probes_ = 0;
+    connections_++;
+  }
+
+  // Start probing again, the first retry after MIN_RETRY_MS
+  void lost(uint32_t now) {
+    last_probe_ = now;
+    retry_ms_ = MIN_RETRY_MS;
+    losses_++;
+  }
+
+  uint32_t retry_ms() const { return retry_ms_; }
+  uint32_t failed_probes() const { return failed_probes_; }
+  uint32_t connections() const { return connections_; }
+  uint32_t losses() const { return losses_; }
+
+ protected:
+  uint32_t last_probe_ = 0;
+  uint32_t retry_ms_ = 0;
+  uint32_t failed_probes_ = 0;
+  uint32_t connections_ = 0;
+  uint32_t losses_ = 0;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
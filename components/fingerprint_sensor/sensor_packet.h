@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+// Confirmation codes returned by the sensor (plus three local ones)
+enum ConfirmCode : uint8_t {
+  CONFIRM_OK = 0x00,
+  CONFIRM_PACKET_RECEIVE_ERR = 0x01,
+  CONFIRM_NO_FINGER = 0x02,
+  CONFIRM_IMAGE_FAIL = 0x03,
+  CONFIRM_IMAGE_MESS = 0x06,
+  CONFIRM_FEATURE_FAIL = 0x07,
+  CONFIRM_NO_MATCH = 0x08,
+  CONFIRM_NOT_FOUND = 0x09,
+  CONFIRM_ENROLL_MISMATCH = 0x0A,
+  CONFIRM_BAD_LOCATION = 0x0B,
+  CONFIRM_DB_READ_FAIL = 0x0C,
+  CONFIRM_UPLOAD_FEATURE_FAIL = 0x0D,
+  CONFIRM_PACKET_RESPONSE_FAIL = 0x0E,
+  CONFIRM_INVALID_IMAGE = 0x15,
+  CONFIRM_FLASH_ERR = 0x18,
+  CONFIRM_INVALID_REG = 0x1A,
+  CONFIRM_PENDING = 0xFD,     // Local: reply not complete yet, see SensorProtocol::poll()
+  CONFIRM_BAD_PACKET = 0xFE,  // Local: malformed frame or wrong checksum
+  CONFIRM_TIMEOUT = 0xFF,     // Local: no response in time
+};
+
+// Instruction codes of the R503/AS608 command set
+enum Instruction : uint8_t {
+  CMD_GET_IMAGE = 0x01,
+  CMD_IMAGE2TZ = 0x02,
+  CMD_SEARCH = 0x04,
+  CMD_REG_MODEL = 0x05,
+  CMD_STORE = 0x06,
+  CMD_LOAD = 0x07,
+  CMD_UPLOAD = 0x08,
+  CMD_DOWNLOAD = 0x09,
+  CMD_DELETE = 0x0C,
+  CMD_EMPTY = 0x0D,
+  CMD_SET_SYS_PARAM = 0x0E,
+  CMD_READ_SYS_PARAM = 0x0F,
+  CMD_VERIFY_PASSWORD = 0x13,
+  CMD_WRITE_NOTEPAD = 0x18,
+  CMD_READ_NOTEPAD = 0x19,
+  CMD_TEMPLATE_COUNT = 0x1D,
+  CMD_READ_INDEX_TABLE = 0x1F,
+  CMD_AURA_LED_CONFIG = 0x35,
+};
+
+// Registers of SetSysPara
+enum SysParam : uint8_t {
+  SYS_PARAM_BAUD_RATE = 4,  // In units of 9600 baud
+  SYS_PARAM_SECURITY_LEVEL = 5,
+  SYS_PARAM_PACKET_SIZE = 6,
+};
+
+enum PacketType : uint8_t {
+  PACKET_COMMAND = 0x01,
+  PACKET_DATA = 0x02,
+  PACKET_ACK = 0x07,
+  PACKET_END_DATA = 0x08,
+};
+
+enum LedMode : uint8_t {
+  LED_BREATHING = 0x01,
+  LED_FLASHING = 0x02,
+  LED_ON = 0x03,
+  LED_OFF = 0x04,
+  LED_GRADUAL_ON = 0x05,
+  LED_GRADUAL_OFF = 0x06,
+};
+
+enum LedColor : uint8_t {
+  LED_RED = 0x01,
+  LED_BLUE = 0x02,
+  LED_PURPLE = 0x03,
+};
+
+static constexpr uint16_t PACKET_START_CODE = 0xEF01;
+static constexpr uint8_t PACKET_HEADER_SIZE = 9;  // start code, address, type, length
+static constexpr uint16_t PACKET_MAX_PAYLOAD = 256;
+static constexpr uint8_t NOTEPAD_PAGE_SIZE = 32;
+static constexpr uint8_t INDEX_TABLE_PAGE_SIZE = 32;
+
+/**
+ * One frame on the wire. length counts payload bytes without the checksum.
+ */
+struct SensorPacket {
+  uint8_t type = 0;
+  uint16_t length = 0;
+  uint8_t data[PACKET_MAX_PAYLOAD];
+};
+
+/**
+ * Sum over type, length and payload, as used by the packet checksum
+ */
+constexpr uint16_t packet_checksum(uint8_t type, const uint8_t *payload, uint16_t length) {
+  uint16_t wire_length = length + 2;
+  uint16_t sum = type + (wire_length >> 8) + (wire_length & 0xFF);
+  for (uint16_t i = 0; i < length; i++) {
+    sum += payload[i];
+  }
+  return sum;
+}
+
+/**
+ * Incremental frame parser shared by the driver and the emulator
+ */
+class PacketParser {
+ public:
+  enum Result : uint8_t { NEED_MORE, COMPLETE, BAD_FRAME };
+
+  void reset() { pos_ = 0; }
+
+  Result feed(uint8_t byte, SensorPacket *packet) {
+    switch (pos_) {
+      case 0:
+        if (byte != (PACKET_START_CODE >> 8)) return NEED_MORE;  // Resync on start code
+        break;
+      case 1:
+        if (byte != (PACKET_START_CODE & 0xFF)) {
+          pos_ = 0;
+          return NEED_MORE;
+        }
+        break;
+      case 2:
+      case 3:
+      case 4:
+      case 5:
+        // Address, not checked: there is one sensor per bus
+        break;
+      case 6:
+        packet->type = byte;
+        break;
+      case 7:
+        wire_length_ = byte << 8;
+        break;
+      case 8:
+        wire_length_ |= byte;
+        if (wire_length_ < 2 || wire_length_ - 2 > PACKET_MAX_PAYLOAD) {
+          pos_ = 0;
+          return BAD_FRAME;
+        }
+        packet->length = wire_length_ - 2;
+        break;
+      default: {
+        uint16_t offset = pos_ - PACKET_HEADER_SIZE;
+        if (offset < packet->length) {
+          packet->data[offset] = byte;
+        } else if (offset == packet->length) {
+          checksum_ = byte << 8;
+        } else {
+          checksum_ |= byte;
+          pos_ = 0;
+          if (checksum_ != packet_checksum(packet->type, packet->data, packet->length)) {
+            return BAD_FRAME;
+          }
+          return COMPLETE;
+        }
+        break;
+      }
+    }
+    pos_++;
+    return NEED_MORE;
+  }
+
+ protected:
+  uint16_t pos_ = 0;
+  uint16_t wire_length_ = 0;
+  uint16_t checksum_ = 0;
+};
+
+/**
+ * Write header and checksum around a payload that is already in place at
+ * frame + PACKET_HEADER_SIZE. frame must hold PACKET_HEADER_SIZE + length + 2
+ * bytes. Returns the frame size.
+ */
+constexpr size_t seal_packet(uint32_t address, uint8_t type, uint16_t length, uint8_t *frame) {
+  uint16_t wire_length = length + 2;
+  frame[0] = PACKET_START_CODE >> 8;
+  frame[1] = PACKET_START_CODE & 0xFF;
+  frame[2] = address >> 24;
+  frame[3] = address >> 16;
+  frame[4] = address >> 8;
+  frame[5] = address;
+  frame[6] = type;
+  frame[7] = wire_length >> 8;
+  frame[8] = wire_length & 0xFF;
+  uint16_t sum = packet_checksum(type, frame + PACKET_HEADER_SIZE, length);
+  frame[PACKET_HEADER_SIZE + length] = sum >> 8;
+  frame[PACKET_HEADER_SIZE + length + 1] = sum & 0xFF;
+  return PACKET_HEADER_SIZE + length + 2;
+}
+
+/**
+ * Serialize one frame into out, which must hold PACKET_HEADER_SIZE + length + 2 bytes.
+ * Returns the number of bytes written.
+ */
+inline size_t encode_packet(uint32_t address, uint8_t type, const uint8_t *payload, uint16_t length, uint8_t *out) {
+  memcpy(out + PACKET_HEADER_SIZE, payload, length);
+  return seal_packet(address, type, length, out);
+}
+
+/**
+ * Whether frame holds exactly one well-formed packet of the given type:
+ * start code, a length field that matches size, and a valid checksum
+ */
+constexpr bool check_packet(const uint8_t *frame, size_t size, uint8_t type) {
+  if (size < PACKET_HEADER_SIZE + 2 || frame[0] != (PACKET_START_CODE >> 8) ||
+      frame[1] != (PACKET_START_CODE & 0xFF) || frame[6] != type) {
+    return false;
+  }
+  uint16_t wire_length = (frame[7] << 8) | frame[8];
+  if (wire_length < 2 || size != size_t(PACKET_HEADER_SIZE) + wire_length) {
+    return false;
+  }
+  uint16_t length = wire_length - 2;
+  if (length > PACKET_MAX_PAYLOAD) {
+    return false;
+  }
+  uint16_t sum = packet_checksum(type, frame + PACKET_HEADER_SIZE, length);
+  return frame[PACKET_HEADER_SIZE + length] == (sum >> 8) && frame[PACKET_HEADER_SIZE + length + 1] == (sum & 0xFF);
+}
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
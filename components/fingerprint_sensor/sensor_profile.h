@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * What differs between the sensor models the driver runs, fixed at compile
+ * time. Codegen picks one from the model: option and hands it to
+ * FingerprintSensor::set_model<>().
+ *
+ * CAPACITY is what the model is sold with and only a starting point: the
+ * sensor reports its real capacity at connection and the driver sizes its
+ * tables from that, never above the profile. Enrollment keeps one image per
+ * pass in its own char buffer, so a model can't take more passes than it has
+ * buffers.
+ */
+struct R503Profile {
+  static constexpr const char *NAME = "R503";
+  static constexpr uint16_t CAPACITY = 200;
+  static constexpr uint8_t CHAR_BUFFERS = 6;
+  static constexpr uint8_t ENROLL_PASSES = 5;
+  static constexpr uint32_t BAUD_RATE = 57600;
+  static constexpr uint32_t SCAN_INTERVAL_MS = 100;
+  static constexpr bool AURA_LED = true;
+};
+
+struct R307Profile {
+  static constexpr const char *NAME = "R307";
+  static constexpr uint16_t CAPACITY = 1000;
+  static constexpr uint8_t CHAR_BUFFERS = 2;
+  static constexpr uint8_t ENROLL_PASSES = 2;
+  static constexpr uint32_t BAUD_RATE = 57600;
+  static constexpr uint32_t SCAN_INTERVAL_MS = 100;
+  static constexpr bool AURA_LED = false;
+};
+
+struct AS608Profile {
+  static constexpr const char *NAME = "AS608";
+  static constexpr uint16_t CAPACITY = 300;
+  static constexpr uint8_t CHAR_BUFFERS = 2;
+  static constexpr uint8_t ENROLL_PASSES = 2;
+  static constexpr uint32_t BAUD_RATE = 57600;
+  static constexpr uint32_t SCAN_INTERVAL_MS = 100;
+  static constexpr bool AURA_LED = false;
+};
+
+/**
+ * One of the profiles above as a value, checked when it is taken
+ */
+struct SensorProfile {
+  const char *name;
+  uint16_t capacity;
+  uint8_t enroll_passes;
+  uint32_t baud_rate;
+  uint32_t scan_interval_ms;
+  bool aura_led;
+
+  template<typename P> static constexpr SensorProfile of() {
+    static_assert(P::ENROLL_PASSES >= 1 && P::ENROLL_PASSES <= P::CHAR_BUFFERS,
+                  "Each enrollment pass needs a char buffer of its own");
+    static_assert(P::CAPACITY >= 2, "ID 0 is reserved, a library needs at least one more slot");
+    static_assert(P::BAUD_RATE % 9600 == 0 && P::BAUD_RATE / 9600 >= 1 && P::BAUD_RATE / 9600 <= 12,
+                  "The sensor only runs at multiples of 9600 baud up to 115200");
+    return {P::NAME, P::CAPACITY, P::ENROLL_PASSES, P::BAUD_RATE, P::SCAN_INTERVAL_MS, P::AURA_LED};
+  }
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
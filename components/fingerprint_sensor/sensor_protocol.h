@@ -0,0 +1,441 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "sensor_commands.h"
+#include "sensor_hal.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Traffic counters of one SensorProtocol, for benchmarks and diagnostics
+ */
+struct ProtocolStats {
+  uint32_t round_trips = 0;
+  uint32_t bytes_sent = 0;
+  uint32_t bytes_received = 0;
+  uint32_t timeouts = 0;
+  uint32_t bad_packets = 0;
+  // Commands resent after a corrupted reply
+  uint32_t retries = 0;
+  // Leftovers of earlier replies thrown away before sending
+  uint32_t discarded_bytes = 0;
+};
+
+/**
+ * Driver for the R503/AS608 packet protocol over any SensorTransport.
+ * Every command is one round trip bounded by a timeout. It either blocks, or
+ * is split into send() and poll() so the caller can do other work while the
+ * sensor is busy.
+ */
+class SensorProtocol {
+ public:
+  static constexpr uint32_t DEFAULT_TIMEOUT_MS = 1000;
+
+  void set_transport(SensorTransport *transport) { transport_ = transport; }
+  void set_clock(Clock *clock) { clock_ = clock; }
+  void set_address(uint32_t address) { address_ = address; }
+  void set_password(uint32_t password) { password_ = password; }
+  // How often an IDEMPOTENT command is resent when its reply fails the checksum
+  void set_retries(uint8_t retries) { retries_ = retries; }
+  // Until get_parameters() has the sensor's own, or to cap what it reported
+  void set_capacity(uint16_t capacity) { capacity_ = capacity; }
+
+  bool verify_password(uint32_t timeout_ms = DEFAULT_TIMEOUT_MS) {
+    VerifyPassword::Password::put(params(), password_);
+    return call<VerifyPassword>(timeout_ms) == CONFIRM_OK;
+  }
+
+  uint8_t get_parameters() {
+    uint8_t result = call<ReadSysParam>();
+    if (result == CONFIRM_OK) {
+      const uint8_t *r = results();
+      status_reg_ = ReadSysParam::StatusReg::get(r);
+      system_id_ = ReadSysParam::SystemId::get(r);
+      capacity_ = ReadSysParam::Capacity::get(r);
+      security_level_ = ReadSysParam::SecurityLevel::get(r);
+      packet_length_ = 32 << ReadSysParam::PacketSize::get(r);
+      baud_rate_ = ReadSysParam::BaudRate::get(r) * 9600;
+    }
+    return result;
+  }
+
+  // Sensor side of a baud rate change. The sensor acknowledges at the old
+  // rate, keeps the new one across power cycles and listens on it right away.
+  uint8_t set_baud_rate(uint32_t baud_rate) {
+    uint8_t *p = params();
+    SetSysParam::Register::put(p, SYS_PARAM_BAUD_RATE);
+    SetSysParam::Value::put(p, baud_rate / 9600);
+    uint8_t result = call<SetSysParam>();
+    if (result == CONFIRM_OK) {
+      baud_rate_ = baud_rate;
+    }
+    return result;
+  }
+
+  uint8_t get_image() { return call<GetImage>(); }
+
+  uint8_t image_to_tz(uint8_t slot = 1) {
+    send_image_to_tz(slot);
+    return wait();
+  }
+
+  void send_image_to_tz(uint8_t slot) {
+    Image2Tz::Slot::put(params(), slot);
+    send<Image2Tz>();
+  }
+
+  // Search the whole library
+  uint8_t search(uint8_t slot = 1) { return search(slot, 0, capacity_); }
+
+  uint8_t search(uint8_t slot, uint16_t start_page, uint16_t page_count) {
+    send_search(slot, start_page, page_count);
+    return wait();
+  }
+
+  // A match is in finger_id() and confidence() once poll() returns CONFIRM_OK
+  void send_search(uint8_t slot, uint16_t start_page, uint16_t page_count) {
+    uint8_t *p = params();
+    Search::Slot::put(p, slot);
+    Search::StartPage::put(p, start_page);
+    Search::PageCount::put(p, page_count);
+    send<Search>();
+  }
+
+  uint8_t create_model() { return call<RegModel>(); }
+
+  uint8_t store_model(uint16_t id, uint8_t slot = 1) {
+    uint8_t *p = params();
+    Store::Slot::put(p, slot);
+    Store::Id::put(p, id);
+    return call<Store>();
+  }
+
+  uint8_t load_model(uint16_t id, uint8_t slot = 1) {
+    uint8_t *p = params();
+    Load::Slot::put(p, slot);
+    Load::Id::put(p, id);
+    return call<Load>();
+  }
+
+  uint8_t delete_model(uint16_t id) {
+    uint8_t *p = params();
+    Delete::StartId::put(p, id);
+    Delete::Count::put(p, 1);
+    return call<Delete>();
+  }
+
+  uint8_t empty_database() { return call<Empty>(); }
+
+  uint8_t get_template_count() {
+    uint8_t result = call<TemplateCount>();
+    if (result == CONFIRM_OK) {
+      template_count_ = TemplateCount::Count::get(results());
+    }
+    return result;
+  }
+
+  uint8_t led_control(uint8_t mode, uint8_t speed, uint8_t color, uint8_t count = 0) {
+    uint8_t *p = params();
+    AuraLedConfig::Mode::put(p, mode);
+    AuraLedConfig::Speed::put(p, speed);
+    AuraLedConfig::Color::put(p, color);
+    AuraLedConfig::Count::put(p, count);
+    return call<AuraLedConfig>();
+  }
+
+  uint8_t write_notepad(uint8_t page, const uint8_t *data) {
+    uint8_t *p = params();
+    WriteNotepad::Page::put(p, page);
+    memcpy(WriteNotepad::Data::at(p), data, WriteNotepad::Data::SIZE);
+    return call<WriteNotepad>();
+  }
+
+  uint8_t read_notepad(uint8_t page, uint8_t *data) {
+    ReadNotepad::Page::put(params(), page);
+    uint8_t result = call<ReadNotepad>();
+    if (result == CONFIRM_OK) {
+      memcpy(data, ReadNotepad::Data::at(results()), ReadNotepad::Data::SIZE);
+    }
+    return result;
+  }
+
+  /**
+   * Read the template in a char buffer. on_data(data, length) gets each data
+   * packet as it arrives, so no more than one packet is ever held in RAM.
+   */
+  template<typename F> uint8_t upload_template(uint8_t slot, F &&on_data) {
+    Upload::Slot::put(params(), slot);
+    uint8_t result = call<Upload>();
+    if (result != CONFIRM_OK) {
+      return result;
+    }
+    while (true) {
+      result = read_packet(&reply_, DATA_TIMEOUT_MS);
+      if (result != CONFIRM_OK) {
+        return result;
+      }
+      if (reply_.type != PACKET_DATA && reply_.type != PACKET_END_DATA) {
+        return CONFIRM_BAD_PACKET;
+      }
+      on_data(reply_.data, reply_.length);
+      if (reply_.type == PACKET_END_DATA) {
+        return CONFIRM_OK;
+      }
+    }
+  }
+
+  // Write a template into a char buffer, split into data packets of the sensor's packet length
+  uint8_t download_template(uint8_t slot, const uint8_t *data, uint16_t length) {
+    Download::Slot::put(params(), slot);
+    uint8_t result = call<Download>();
+    if (result != CONFIRM_OK) {
+      return result;
+    }
+    for (uint16_t offset = 0; offset < length; offset += packet_length_) {
+      uint16_t size = length - offset < packet_length_ ? length - offset : packet_length_;
+      write_packet(offset + size < length ? PACKET_DATA : PACKET_END_DATA, data + offset, size);
+    }
+    return CONFIRM_OK;
+  }
+
+  // Occupancy bitmap of template slots page * 256 .. page * 256 + 255
+  uint8_t read_index_table(uint8_t page, uint8_t *bitmap) {
+    ReadIndexTable::Page::put(params(), page);
+    uint8_t result = call<ReadIndexTable>();
+    if (result == CONFIRM_OK) {
+      memcpy(bitmap, ReadIndexTable::Bitmap::at(results()), ReadIndexTable::Bitmap::SIZE);
+    }
+    return result;
+  }
+
+  /**
+   * Parameter bytes of the next command, to be filled through the fields of
+   * its descriptor before send() or call(). A split command still in flight
+   * gets its reply first, as its frame is kept for resending.
+   */
+  uint8_t *params() {
+    wait();
+    return tx_.params();
+  }
+
+  // Send command C with the parameters in params() and wait for its acknowledge
+  template<typename C> uint8_t call(uint32_t timeout_ms = DEFAULT_TIMEOUT_MS) {
+    wait();
+    send<C>(timeout_ms);
+    return wait();
+  }
+
+  /**
+   * Send command C with the parameters in params() and return without
+   * waiting. poll() picks up the acknowledge; only one command can be in
+   * flight. Once it returns CONFIRM_OK, the reply holds all of C's results.
+   *
+   * The protocol has no sequence numbers, so a reply is matched to its
+   * command by clearing the receive buffer first: a late reply to a command
+   * that timed out can't be taken for this one's. A corrupted reply is
+   * retried only if C is IDEMPOTENT, the others fail with CONFIRM_BAD_PACKET.
+   */
+  template<typename C> void send(uint32_t timeout_ms = DEFAULT_TIMEOUT_MS) {
+    tx_.seal<C>(address_);
+    start(C::RESPONSE, timeout_ms, C::IDEMPOTENT);
+  }
+
+  /**
+   * Command only known at runtime, e.g. queued on the SensorBus. results is
+   * the size of its results and idempotent whether it may be resent, as in
+   * the RESPONSE and IDEMPOTENT of its descriptor.
+   * Returns the confirmation code; the full reply stays available via reply().
+   */
+  uint8_t command(uint8_t instruction, const uint8_t *params, uint16_t length, uint16_t results = 0,
+                  uint32_t timeout_ms = DEFAULT_TIMEOUT_MS, bool idempotent = false) {
+    if (length > CommandFrame::MAX_PARAMS || 1 + results > PACKET_MAX_PAYLOAD) {
+      return CONFIRM_BAD_PACKET;
+    }
+    uint8_t *frame_params = this->params();
+    if (length > 0) {
+      memcpy(frame_params, params, length);
+    }
+    tx_.seal(address_, instruction, length);
+    start(results, timeout_ms, idempotent);
+    return wait();
+  }
+
+  // Confirmation code of the last command sent, CONFIRM_PENDING while its reply is incomplete
+  uint8_t poll() {
+    if (!busy_) {
+      return result_;
+    }
+    while (transport_->available() > 0) {
+      stats_.bytes_received++;
+      switch (parser_.feed(transport_->read(), &reply_)) {
+        case PacketParser::COMPLETE:
+          // A success without all results is as corrupt as a bad checksum
+          if (reply_.type != PACKET_ACK || reply_.length < 1 ||
+              (reply_.data[0] == CONFIRM_OK && reply_.length < 1 + results_)) {
+            stats_.bad_packets++;
+            return retry(CONFIRM_BAD_PACKET);
+          }
+          return finish(reply_.data[0]);
+        case PacketParser::BAD_FRAME:
+          stats_.bad_packets++;
+          return retry(CONFIRM_BAD_PACKET);
+        case PacketParser::NEED_MORE:
+          break;
+      }
+    }
+    if (clock_->millis() - sent_at_ >= timeout_ms_) {
+      stats_.timeouts++;
+      return finish(CONFIRM_TIMEOUT);
+    }
+    return CONFIRM_PENDING;
+  }
+
+  uint8_t wait() {
+    uint8_t result;
+    while ((result = poll()) == CONFIRM_PENDING) {
+      clock_->wait_us(POLL_INTERVAL_US);
+    }
+    return result;
+  }
+
+  // A command was sent and its reply is not complete yet
+  bool busy() const { return busy_; }
+
+  void discard_input() {
+    while (transport_->available() > 0) {
+      transport_->read();
+      stats_.discarded_bytes++;
+    }
+  }
+
+  void write_packet(uint8_t type, const uint8_t *payload, uint16_t length) {
+    uint8_t frame[PACKET_HEADER_SIZE + PACKET_MAX_PAYLOAD + 2];
+    size_t size = encode_packet(address_, type, payload, length, frame);
+    transport_->write(frame, size);
+    stats_.bytes_sent += size;
+  }
+
+  uint8_t read_packet(SensorPacket *packet, uint32_t timeout_ms = DEFAULT_TIMEOUT_MS) {
+    uint32_t start = clock_->millis();
+    parser_.reset();
+    while (true) {
+      if (transport_->available() <= 0) {
+        if (clock_->millis() - start >= timeout_ms) {
+          stats_.timeouts++;
+          return CONFIRM_TIMEOUT;
+        }
+        clock_->wait_us(POLL_INTERVAL_US);
+        continue;
+      }
+      stats_.bytes_received++;
+      switch (parser_.feed(transport_->read(), packet)) {
+        case PacketParser::COMPLETE:
+          return CONFIRM_OK;
+        case PacketParser::BAD_FRAME:
+          stats_.bad_packets++;
+          return CONFIRM_BAD_PACKET;
+        case PacketParser::NEED_MORE:
+          break;
+      }
+    }
+  }
+
+  const SensorPacket &reply() const { return reply_; }
+  // Results of the last acknowledge, behind its confirmation code
+  const uint8_t *results() const { return ack_results(reply_); }
+  const ProtocolStats &stats() const { return stats_; }
+  // Commands in a row that got no reply at all
+  uint32_t silent_commands() const { return silent_commands_; }
+  uint16_t finger_id() const { return finger_id_; }
+  uint16_t confidence() const { return confidence_; }
+  uint16_t template_count() const { return template_count_; }
+  uint16_t capacity() const { return capacity_; }
+  uint16_t security_level() const { return security_level_; }
+  uint16_t status_reg() const { return status_reg_; }
+  uint16_t system_id() const { return system_id_; }
+  uint16_t packet_length() const { return packet_length_; }
+  uint32_t baud_rate() const { return baud_rate_; }
+
+ protected:
+  static constexpr uint32_t POLL_INTERVAL_US = 100;
+  static constexpr uint32_t RETRY_QUIET_US = 2000;
+  // Gap allowed between two data packets of an upload
+  static constexpr uint32_t DATA_TIMEOUT_MS = 200;
+
+  void start(uint16_t results, uint32_t timeout_ms, bool idempotent) {
+    results_ = results;
+    timeout_ms_ = timeout_ms;
+    idempotent_ = idempotent;
+    attempt_ = 0;
+    busy_ = true;
+    transmit();
+  }
+
+  void transmit() {
+    discard_input();
+    transport_->write(tx_.data(), tx_.size());
+    stats_.bytes_sent += tx_.size();
+    stats_.round_trips++;
+    parser_.reset();
+    sent_at_ = clock_->millis();
+  }
+
+  uint8_t retry(uint8_t result) {
+    if (!idempotent_ || attempt_ >= retries_) {
+      return finish(result);
+    }
+    // Let the rest of the broken frame arrive so it is discarded, not parsed
+    attempt_++;
+    stats_.retries++;
+    clock_->wait_us(RETRY_QUIET_US);
+    transmit();
+    return CONFIRM_PENDING;
+  }
+
+  uint8_t finish(uint8_t result) {
+    busy_ = false;
+    result_ = result;
+    silent_commands_ = result == CONFIRM_TIMEOUT ? silent_commands_ + 1 : 0;
+    if (result == CONFIRM_OK && tx_.instruction() == CMD_SEARCH) {
+      finger_id_ = Search::FingerId::get(results());
+      confidence_ = Search::Confidence::get(results());
+    }
+    return result;
+  }
+
+  SensorTransport *transport_{nullptr};
+  Clock *clock_{nullptr};
+  uint32_t address_ = 0xFFFFFFFF;
+  uint32_t password_ = 0;
+  uint8_t retries_ = 2;
+  PacketParser parser_;
+  SensorPacket reply_;
+  ProtocolStats stats_;
+  uint32_t silent_commands_ = 0;
+  // Command in flight, kept for resending
+  CommandFrame tx_;
+  // Result bytes its acknowledge must carry
+  uint16_t results_ = 0;
+  // Whether it may be resent after a corrupted reply
+  bool idempotent_ = false;
+  uint32_t timeout_ms_ = DEFAULT_TIMEOUT_MS;
+  uint32_t sent_at_ = 0;
+  uint8_t attempt_ = 0;
+  bool busy_ = false;
+  uint8_t result_ = CONFIRM_OK;
+
+  uint16_t finger_id_ = 0;
+  uint16_t confidence_ = 0;
+  uint16_t template_count_ = 0;
+  uint16_t capacity_ = 200;
+  uint16_t security_level_ = 0;
+  uint16_t status_reg_ = 0;
+  uint16_t system_id_ = 0;
+  uint16_t packet_length_ = 128;
+  uint32_t baud_rate_ = 57600;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+/**
+ * Shares the main loop between the readers of one ESP.
+ *
+ * Each reader has its own UART, so scans run side by side: a scan step sends
+ * its command and comes back for the reply on a later pass, and the readers
+ * tell the scheduler while they have one in flight. Everything that still
+ * blocks (enrollment steps, LED updates, bus jobs, connection probes) waits
+ * for the reader's turn, which only comes while no other reader is mid-scan.
+ * Turns go round in join order and are skipped by readers with nothing to do.
+ *
+ * A lone reader is always on turn and waits for its replies as before.
+ */
+class SensorScheduler {
+ public:
+  static constexpr uint8_t MAX_MEMBERS = 32;
+
+  uint8_t join() { return members_++; }
+  uint8_t members() const { return members_; }
+
+  // Set while the member's scan waits for a reply. May be called from a sensor task.
+  void set_scanning(uint8_t member, bool scanning) {
+    uint32_t bit = 1UL << member;
+    if (scanning) {
+      scanning_ |= bit;
+    } else {
+      scanning_ &= ~bit;
+    }
+  }
+
+  // May member run blocking work now? Without any, it passes the turn on.
+  bool take_turn(uint8_t member, bool wants) {
+    if (turn_ != member) {
+      return false;
+    }
+    if (!wants) {
+      turn_ = (turn_ + 1) % members_;
+      return false;
+    }
+    return (scanning_ & ~(1UL << member)) == 0;
+  }
+
+  // Blocking work of this turn is done
+  void done(uint8_t member) {
+    if (turn_ == member) {
+      turn_ = (turn_ + 1) % members_;
+    }
+  }
+
+  uint32_t scanning() const { return scanning_; }
+
+ protected:
+  uint8_t members_ = 0;
+  uint8_t turn_ = 0;
+  std::atomic<uint32_t> scanning_{0};
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include "sensor_hal.h"
+
+namespace esphome {
+namespace fingerprint_sensor {
+
+// Instrumented steps of the scan and enrollment paths
+enum Stage : uint8_t {
+  STAGE_GET_IMAGE,
+  STAGE_IMAGE2TZ,
+  STAGE_SEARCH,
+  STAGE_LED,
+  STAGE_PUBLISH,
+  STAGE_ENROLL_IMAGE,
+  STAGE_ENROLL_CONVERT,
+  STAGE_ENROLL_MODEL,
+  STAGE_COUNT,
+};
+
+enum StageStatistic : uint8_t {
+  STAGE_STAT_P50,
+  STAGE_STAT_P95,
+  STAGE_STAT_MAX,
+  STAGE_STAT_COUNT,
+};
+
+/**
+ * Fixed-bucket latency histogram. Recording is a short linear scan over a
+ * constant table, no allocation; percentiles resolve to the bucket's upper
+ * bound, which is plenty to tell a 2 ms LED command from a 100 ms search.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr uint8_t BUCKETS = 26;
+
+  void record(uint32_t us) {
+    uint8_t bucket = 0;
+    while (bucket < BUCKETS - 1 && us > BUCKET_BOUNDS_US[bucket]) {
+      bucket++;
+    }
+    counts_[bucket]++;
+    total_++;
+    if (us > max_) {
+      max_ = us;
+    }
+  }
+
+  uint32_t percentile(float fraction) const {
+    if (total_ == 0) {
+      return 0;
+    }
+    uint32_t rank = uint32_t(total_ * fraction);
+    uint32_t seen = 0;
+    for (uint8_t bucket = 0; bucket < BUCKETS; bucket++) {
+      seen += counts_[bucket];
+      if (seen > rank) {
+        // The last bucket is open-ended, the maximum is the better answer there
+        return bucket < BUCKETS - 1 && BUCKET_BOUNDS_US[bucket] < max_ ? BUCKET_BOUNDS_US[bucket] : max_;
+      }
+    }
+    return max_;
+  }
+
+  uint32_t max() const { return max_; }
+  uint32_t count() const { return total_; }
+
+  void merge(const LatencyHistogram &other) {
+    for (uint8_t bucket = 0; bucket < BUCKETS; bucket++) {
+      counts_[bucket] += other.counts_[bucket];
+    }
+    total_ += other.total_;
+    if (other.max_ > max_) {
+      max_ = other.max_;
+    }
+  }
+
+  void reset() {
+    for (auto &count : counts_) {
+      count = 0;
+    }
+    total_ = 0;
+    max_ = 0;
+  }
+
+ protected:
+  // 1-1.5-2-3-5-7.5 series from 50 us to 1 s
+  static constexpr uint32_t BUCKET_BOUNDS_US[BUCKETS] = {
+      50,    100,   150,   200,    300,    500,    750,    1000,   1500,   2000,   3000,   5000,    7500,
+      10000, 15000, 20000, 30000,  50000,  75000,  100000, 150000, 200000, 300000, 500000, 1000000, UINT32_MAX,
+  };
+
+  uint32_t counts_[BUCKETS] = {0};
+  uint32_t total_ = 0;
+  uint32_t max_ = 0;
+};
+
+/**
+ * One histogram per stage
+ */
+class StageTimings {
+ public:
+  void record(Stage stage, uint32_t us) { histograms_[stage].record(us); }
+  const LatencyHistogram &get(Stage stage) const { return histograms_[stage]; }
+  void merge(const StageTimings &other) {
+    for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+      histograms_[stage].merge(other.histograms_[stage]);
+    }
+  }
+  void reset() {
+    for (auto &histogram : histograms_) {
+      histogram.reset();
+    }
+  }
+
+ protected:
+  LatencyHistogram histograms_[STAGE_COUNT];
+};
+
+/**
+ * Records the lifetime of the enclosing scope into a stage histogram
+ */
+class ScopedStageTimer {
+ public:
+  ScopedStageTimer(StageTimings *timings, Clock *clock, Stage stage)
+      : timings_(timings), clock_(clock), stage_(stage), start_(clock->micros()) {}
+  ~ScopedStageTimer() { timings_->record(stage_, clock_->micros() - start_); }
+
+ protected:
+  StageTimings *timings_;
+  Clock *clock_;
+  Stage stage_;
+  uint32_t start_;
+};
+
+}  // namespace fingerprint_sensor
+}  // namespace esphome